@@ -0,0 +1,559 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <math.h>
+#include <immintrin.h>
+#include <cpuid.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+const char* precondition_names[NUM_PRECONDITIONS] = {"warm", "cold", "evict", "dirty"};
+
+// Built-in tests, in suite order. A new test family defines its descriptor
+// in its own file and adds it here.
+extern const cachebench_test_t latency_test;
+extern const cachebench_test_t stride_test;
+extern const cachebench_test_t thrashing_test;
+extern const cachebench_test_t read_write_test;
+extern const cachebench_test_t l3_test;
+extern const cachebench_test_t histogram_test;
+extern const cachebench_test_t profile_test;
+extern const cachebench_test_t blocking_test;
+extern const cachebench_test_t layout_test;
+extern const cachebench_test_t hash_test;
+extern const cachebench_test_t search_test;
+extern const cachebench_test_t traversal_test;
+extern const cachebench_test_t alloc_test;
+extern const cachebench_test_t contention_test;
+extern const cachebench_test_t queue_test;
+extern const cachebench_test_t forwarding_test;
+extern const cachebench_test_t width_test;
+extern const cachebench_test_t gather_test;
+extern const cachebench_test_t icache_test;
+extern const cachebench_test_t branch_test;
+extern const cachebench_test_t fault_test;
+extern const cachebench_test_t file_test;
+extern const cachebench_test_t uring_test;
+extern const cachebench_test_t coherence_test;
+
+static const cachebench_test_t* builtin_tests[] = {
+    &latency_test,
+    &stride_test,
+    &thrashing_test,
+    &read_write_test,
+    &l3_test,
+    &histogram_test,
+    &profile_test,
+    &blocking_test,
+    &layout_test,
+    &hash_test,
+    &search_test,
+    &traversal_test,
+    &alloc_test,
+    &contention_test,
+    &queue_test,
+    &forwarding_test,
+    &width_test,
+    &gather_test,
+    &icache_test,
+    &branch_test,
+    &fault_test,
+    &file_test,
+    &uring_test,
+    &coherence_test,
+};
+
+static const cachebench_test_t* registry[MAX_TESTS];
+static int num_registered = -1;
+
+static void init_registry() {
+    if (num_registered >= 0) return;
+    num_registered = 0;
+    for (size_t i = 0; i < sizeof(builtin_tests) / sizeof(builtin_tests[0]); i++) {
+        registry[num_registered++] = builtin_tests[i];
+    }
+}
+
+// Add a test to the registry; returns its index or -1 when full or taken
+int cachebench_register_test(const cachebench_test_t* test) {
+    init_registry();
+    if (num_registered >= MAX_TESTS || cachebench_find_test(test->name) >= 0) return -1;
+    registry[num_registered] = test;
+    return num_registered++;
+}
+
+int cachebench_num_tests() {
+    init_registry();
+    return num_registered;
+}
+
+const cachebench_test_t* cachebench_get_test(int index) {
+    init_registry();
+    return index >= 0 && index < num_registered ? registry[index] : NULL;
+}
+
+int cachebench_find_test(const char* name) {
+    init_registry();
+    for (int i = 0; i < num_registered; i++) {
+        if (strcmp(registry[i]->name, name) == 0) return i;
+    }
+    return -1;
+}
+
+void cachebench_init(cachebench_context_t* ctx) {
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->out = stdout;
+    ctx->iterations = NUM_ITERATIONS;
+    ctx->latency_sweep = (sweep_config_t){MIN_SIZE, MAX_SIZE, 1, 0};
+    ctx->l3_sweep = (sweep_config_t){4 * 1024 * 1024, 64 * 1024 * 1024, 3, 0};
+    ctx->histogram = (histogram_options_t){100000, 1, 0};
+    ctx->blocking = (blocking_options_t){2048, 512};
+    ctx->file = (file_options_t){NULL, FILE_DEFAULT_SIZE};
+}
+
+void cachebench_free(cachebench_context_t* ctx) {
+    arena_destroy(ctx);
+    free_results(&ctx->results);
+}
+
+// Run one registered test with its configured preconditioning mode
+int cachebench_run_test(cachebench_context_t* ctx, const char* name) {
+    int index = cachebench_find_test(name);
+    if (index < 0) return -1;
+
+    ctx->mode = ctx->precondition[index];
+    registry[index]->run(ctx);
+    return 0;
+}
+
+void cachebench_run_suite(cachebench_context_t* ctx) {
+    for (int i = 0; i < cachebench_num_tests(); i++) {
+        if (registry[i]->flags & TEST_IN_SUITE) {
+            cachebench_run_test(ctx, registry[i]->name);
+        }
+    }
+}
+
+void cachebench_printf(cachebench_context_t* ctx, const char* format, ...) {
+    if (!ctx->out) return;
+    va_list args;
+    va_start(args, format);
+    vfprintf(ctx->out, format, args);
+    va_end(args);
+}
+
+double get_time_ms() {
+#ifdef _WIN32
+    LARGE_INTEGER freq, counter;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart * 1000.0 / freq.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+#endif
+}
+
+void format_size(size_t size, char* out, size_t len) {
+    if (size < 1024) {
+        snprintf(out, len, "%zu B", size);
+    } else if (size < 1024 * 1024) {
+        if (size % 1024 == 0) snprintf(out, len, "%zu KB", size / 1024);
+        else snprintf(out, len, "%.1f KB", size / 1024.0);
+    } else {
+        if (size % (1024 * 1024) == 0) snprintf(out, len, "%zu MB", size / (1024 * 1024));
+        else snprintf(out, len, "%.1f MB", size / (1024.0 * 1024.0));
+    }
+}
+
+// Parse a size such as "4096", "32K", "1.5M" or "2G"
+int parse_size(const char* text, size_t* out) {
+    char* end;
+    double value = strtod(text, &end);
+    if (end == text || value <= 0) return -1;
+
+    switch (*end) {
+        case 'k': case 'K': value *= 1024; end++; break;
+        case 'm': case 'M': value *= 1024 * 1024; end++; break;
+        case 'g': case 'G': value *= 1024.0 * 1024 * 1024; end++; break;
+    }
+    if (*end == 'B' || *end == 'b') end++;
+    if (*end != '\0') return -1;
+
+    *out = (size_t)value;
+    return 0;
+}
+
+// Parse "MIN:MAX" into a sweep range
+int parse_range(const char* text, sweep_config_t* sweep) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s", text);
+    char* colon = strchr(buf, ':');
+    if (!colon) return -1;
+    *colon = '\0';
+
+    size_t min_size, max_size;
+    if (parse_size(buf, &min_size) || parse_size(colon + 1, &max_size)) return -1;
+    if (min_size > max_size) return -1;
+
+    sweep->min_size = min_size;
+    sweep->max_size = max_size;
+    return 0;
+}
+
+static size_t round_to_line(double size) {
+    size_t rounded = (size_t)(size / SWEEP_ALIGNMENT + 0.5) * SWEEP_ALIGNMENT;
+    return rounded < SWEEP_ALIGNMENT ? SWEEP_ALIGNMENT : rounded;
+}
+
+// Expand a sweep configuration into an ascending list of working-set sizes.
+// Geometric sweeps place points_per_octave sizes between each power of two;
+// linear sweeps add step bytes per point. Sizes are line-rounded, duplicates
+// dropped, and the range end is always included.
+int generate_sweep(const sweep_config_t* sweep, size_t* sizes, int max_sizes) {
+    int count = 0;
+    size_t min_size = round_to_line(sweep->min_size);
+    size_t max_size = round_to_line(sweep->max_size);
+
+    for (int i = 0; count < max_sizes; i++) {
+        double size;
+        if (sweep->step > 0) {
+            size = (double)min_size + (double)sweep->step * i;
+        } else {
+            int per_octave = sweep->points_per_octave > 0 ? sweep->points_per_octave : 1;
+            size = min_size * pow(2.0, (double)i / per_octave);
+        }
+
+        size_t rounded = round_to_line(size);
+        if (rounded > max_size) break;
+        if (count == 0 || rounded > sizes[count - 1]) sizes[count++] = rounded;
+    }
+
+    if (count < max_sizes && (count == 0 || sizes[count - 1] < max_size)) {
+        sizes[count++] = max_size;
+    }
+    return count;
+}
+
+// Allocate the arena, touch every page so no test pays first-touch faults,
+// and pin it so pages cannot be reclaimed between tests. Locking is best
+// effort: RLIMIT_MEMLOCK is often smaller than the arena.
+int arena_init(cachebench_context_t* ctx, size_t size) {
+    size = (size + 4095) & ~(size_t)4095;
+    ctx->arena.base = aligned_alloc(4096, size);
+    if (!ctx->arena.base) {
+        cachebench_printf(ctx, "Failed to allocate %zu byte arena\n", size);
+        return -1;
+    }
+
+    memset(ctx->arena.base, 0xAA, size);
+    ctx->arena.size = size;
+
+#ifndef _WIN32
+    ctx->arena.locked = mlock(ctx->arena.base, size) == 0;
+#endif
+    return 0;
+}
+
+void arena_destroy(cachebench_context_t* ctx) {
+#ifndef _WIN32
+    if (ctx->arena.locked) munlock(ctx->arena.base, ctx->arena.size);
+#endif
+    free(ctx->arena.base);
+    ctx->arena.base = NULL;
+    ctx->arena.size = 0;
+    ctx->arena.locked = 0;
+
+    free(ctx->eviction.base);
+    ctx->eviction.base = NULL;
+    ctx->eviction.size = 0;
+}
+
+// Return the arena start, growing the arena if it cannot hold size bytes.
+// Callers that size the arena up front with required_arena_size never grow.
+char* arena_buffer(cachebench_context_t* ctx, size_t size) {
+    if (size > ctx->arena.size) {
+#ifndef _WIN32
+        if (ctx->arena.locked) munlock(ctx->arena.base, ctx->arena.size);
+#endif
+        free(ctx->arena.base);
+        ctx->arena.base = NULL;
+        ctx->arena.size = 0;
+        ctx->arena.locked = 0;
+        if (arena_init(ctx, size) != 0) return NULL;
+    }
+    return ctx->arena.base;
+}
+
+// Size the arena for the largest test: sweeps, or the associativity and
+// read/write tests at twice the L3 size
+size_t required_arena_size(const cachebench_context_t* ctx) {
+    size_t arena_size = MAX_SIZE;
+    if (ctx->latency_sweep.max_size > arena_size) arena_size = ctx->latency_sweep.max_size;
+    if (ctx->l3_sweep.max_size > arena_size) arena_size = ctx->l3_sweep.max_size;
+    if (L3_CACHE_SIZE * 2 > arena_size) arena_size = L3_CACHE_SIZE * 2;
+    return arena_size;
+}
+
+static int has_clflushopt() {
+    static int cached = -1;
+    if (cached < 0) {
+        unsigned int eax, ebx, ecx, edx;
+        cached = __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & (1u << 23));
+    }
+    return cached;
+}
+
+__attribute__((target("clflushopt")))
+static void flush_range_opt(volatile char* ptr, size_t size) {
+    for (size_t j = 0; j < size; j += CACHE_LINE_SIZE) {
+        _mm_clflushopt((void*)&ptr[j]);
+    }
+}
+
+static void flush_range(volatile char* ptr, size_t size) {
+    if (has_clflushopt()) {
+        flush_range_opt(ptr, size);
+    } else {
+        for (size_t j = 0; j < size; j += CACHE_LINE_SIZE) {
+            _mm_clflush((const void*)&ptr[j]);
+        }
+    }
+    _mm_mfence();
+}
+
+// Twice the larger of the nominal and OS-reported LLC, so streaming it
+// displaces every line of the working set
+static size_t eviction_size() {
+    size_t llc = L3_CACHE_SIZE;
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    long reported = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (reported > 0 && (size_t)reported > llc) llc = reported;
+#endif
+    return llc * 2;
+}
+
+// Touched lines are read into this so the loads are not optimized away
+static volatile char touch_sink;
+
+static void evict_caches(cachebench_context_t* ctx) {
+    if (!ctx->eviction.base) {
+        size_t size = eviction_size();
+        ctx->eviction.base = aligned_alloc(4096, size);
+        if (!ctx->eviction.base) {
+            cachebench_printf(ctx, "Failed to allocate %zu byte eviction buffer\n", size);
+            return;
+        }
+        memset(ctx->eviction.base, 0x55, size);
+        ctx->eviction.size = size;
+    }
+
+    volatile char* ptr = (volatile char*)ctx->eviction.base;
+    for (size_t j = 0; j < ctx->eviction.size; j += CACHE_LINE_SIZE) {
+        touch_sink = ptr[j];
+    }
+}
+
+// Put the first size bytes of buffer in the requested cache state
+void precondition_buffer(cachebench_context_t* ctx, void* buffer, size_t size, precondition_t mode) {
+    volatile char* ptr = (volatile char*)buffer;
+
+    switch (mode) {
+    case PRECONDITION_WARM:
+        for (size_t j = 0; j < size; j += CACHE_LINE_SIZE) {
+            touch_sink = ptr[j];
+        }
+        break;
+    case PRECONDITION_COLD:
+        flush_range(ptr, size);
+        break;
+    case PRECONDITION_EVICT:
+        evict_caches(ctx);
+        break;
+    case PRECONDITION_DIRTY:
+        // Write back what is there so pointer chains and tables survive
+        for (size_t j = 0; j < size; j += CACHE_LINE_SIZE) {
+            ptr[j] = ptr[j];
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// Worker threads for concurrent tests: --threads, or one per online CPU
+int worker_threads(const cachebench_context_t* ctx) {
+    if (ctx->threads > 0) return ctx->threads;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    return cpus > 0 ? (int)cpus : 1;
+}
+
+// Iterations in chunk c when a loop is split into RESULT_SAMPLES chunks
+int chunk_iterations(int iterations, int c) {
+    int n = iterations / RESULT_SAMPLES + (c < iterations % RESULT_SAMPLES);
+    return n > 0 ? n : 1;
+}
+
+// Precondition the buffer, time the first pass on its own, then run the
+// steady-state loop in RESULT_SAMPLES chunks. first_ns receives the
+// first-pass cost and samples the per-chunk cost, in ns per cache line.
+double run_line_kernel(cachebench_context_t* ctx, line_kernel_t kernel, void* buffer, size_t size,
+                       int iterations, double* first_ns, double* samples) {
+    double lines = (double)(size / CACHE_LINE_SIZE);
+
+    precondition_buffer(ctx, buffer, size, ctx->mode);
+    double first_ms = kernel(buffer, size, 1);
+    *first_ns = first_ms * 1e6 / lines;
+
+    double total = 0;
+    for (int c = 0; c < RESULT_SAMPLES; c++) {
+        int n = chunk_iterations(iterations, c);
+        double ms = kernel(buffer, size, n);
+        samples[c] = ms * 1e6 / (lines * n);
+        total += ms;
+    }
+    return total;
+}
+
+// Same for the random pattern; first_ns and samples are per access
+double run_random_kernel(cachebench_context_t* ctx, void* buffer, size_t size, int iterations,
+                         double* first_ns, double* samples) {
+    double accesses = (double)(size / sizeof(size_t));
+    size_t* indices = create_random_indices(size);
+    if (!indices) return -1;
+
+    precondition_buffer(ctx, buffer, size, ctx->mode);
+    double first_ms = benchmark_random_pattern(buffer, indices, size, 1);
+    *first_ns = first_ms * 1e6 / accesses;
+
+    double total = 0;
+    for (int c = 0; c < RESULT_SAMPLES; c++) {
+        int n = chunk_iterations(iterations, c);
+        double ms = benchmark_random_pattern(buffer, indices, size, n);
+        samples[c] = ms * 1e6 / (accesses * n);
+        total += ms;
+    }
+
+    free(indices);
+    return total;
+}
+
+static int histogram_bucket(uint64_t value) {
+    if (value < HIST_SUB_BUCKETS) return (int)value;
+
+    int magnitude = 63 - __builtin_clzll(value);
+    if (magnitude >= HIST_MAX_BITS) return HIST_BUCKETS - 1;
+    int sub = (int)(value >> (magnitude - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1);
+    return (magnitude - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS + sub;
+}
+
+uint64_t histogram_bucket_low(int bucket) {
+    if (bucket < HIST_SUB_BUCKETS) return bucket;
+
+    int magnitude = bucket / HIST_SUB_BUCKETS + HIST_SUB_BITS - 1;
+    int sub = bucket % HIST_SUB_BUCKETS;
+    return ((uint64_t)(HIST_SUB_BUCKETS + sub)) << (magnitude - HIST_SUB_BITS);
+}
+
+uint64_t histogram_bucket_high(int bucket) {
+    return bucket + 1 < HIST_BUCKETS ? histogram_bucket_low(bucket + 1) - 1 : UINT64_MAX;
+}
+
+void histogram_record(latency_histogram_t* hist, uint64_t value) {
+    hist->counts[histogram_bucket(value)]++;
+    if (hist->total == 0 || value < hist->min) hist->min = value;
+    if (value > hist->max) hist->max = value;
+    hist->total++;
+}
+
+// Value at the given percentile, reported as the midpoint of its bucket
+double histogram_percentile(const latency_histogram_t* hist, double percentile) {
+    if (hist->total == 0) return 0;
+
+    uint64_t rank = (uint64_t)ceil(percentile / 100.0 * hist->total);
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        seen += hist->counts[b];
+        if (seen >= rank) {
+            uint64_t high = histogram_bucket_high(b);
+            if (high > hist->max) high = hist->max;
+            return (histogram_bucket_low(b) + high) / 2.0;
+        }
+    }
+    return hist->max;
+}
+
+// Cycles of TSC per nanosecond, measured against the monotonic clock
+double measure_tsc_ghz() {
+    double start_ms = get_time_ms();
+    uint64_t start_tsc = get_cycles();
+    while (get_time_ms() - start_ms < 50.0) {
+    }
+    uint64_t end_tsc = get_cycles();
+    double end_ms = get_time_ms();
+    return (end_tsc - start_tsc) / ((end_ms - start_ms) * 1e6);
+}
+
+static inline uint64_t timer_start() {
+    _mm_lfence();
+    uint64_t t = __rdtsc();
+    _mm_lfence();
+    return t;
+}
+
+static inline uint64_t timer_stop() {
+    unsigned int aux;
+    uint64_t t = __rdtscp(&aux);
+    _mm_lfence();
+    return t;
+}
+
+// Cost of an empty fenced timing region, subtracted from every sample
+uint64_t measure_timer_overhead() {
+    uint64_t best = UINT64_MAX;
+    for (int i = 0; i < 10000; i++) {
+        uint64_t t0 = timer_start();
+        uint64_t t1 = timer_stop();
+        if (t1 - t0 < best) best = t1 - t0;
+    }
+    return best;
+}
+
+// Keeps chase results live so the loads are not optimized away
+static void* volatile chase_sink;
+
+// Time batches of dependent pointer-chase loads with fenced rdtsc/rdtscp
+// and record cycles per load. With warm_up, one full lap runs first so the
+// samples see the steady state; without it the first lap is sampled in
+// whatever state the caller preconditioned.
+void sample_chase_latency(void** start, size_t num_lines, int samples, int batch,
+                          uint64_t overhead, int warm_up, latency_histogram_t* hist) {
+    void** p = start;
+
+    if (warm_up) {
+        for (size_t i = 0; i < num_lines; i++) p = (void**)*p;
+    }
+
+    for (int s = 0; s < samples; s++) {
+        uint64_t t0 = timer_start();
+        for (int b = 0; b < batch; b++) p = (void**)*p;
+        uint64_t t1 = timer_stop();
+
+        uint64_t elapsed = t1 - t0;
+        elapsed = elapsed > overhead ? elapsed - overhead : 0;
+        histogram_record(hist, (elapsed + batch / 2) / batch);
+    }
+
+    chase_sink = p;
+}
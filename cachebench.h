@@ -0,0 +1,373 @@
+#ifndef CACHEBENCH_H
+#define CACHEBENCH_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_LINE_SIZE 64
+
+// Typical cache sizes for AMD Ryzen 5600
+#define L1_CACHE_SIZE (32 * 1024)      // 32KB L1 Data Cache per core
+#define L2_CACHE_SIZE (512 * 1024)     // 512KB L2 Cache per core
+#define L3_CACHE_SIZE (32 * 1024 * 1024) // 32MB L3 Cache shared
+
+// Test array sizes
+#define MIN_SIZE (4 * 1024)            // 4KB
+#define MAX_SIZE (128 * 1024 * 1024)   // 128MB
+#define NUM_ITERATIONS 1000000
+
+// Working-set sweeps
+#define MAX_SWEEP_POINTS 512
+#define SWEEP_ALIGNMENT CACHE_LINE_SIZE // Sweep sizes are rounded to whole lines
+
+typedef struct {
+    size_t min_size;
+    size_t max_size;
+    int points_per_octave;             // Geometric spacing, used when step is 0
+    size_t step;                       // Linear spacing in bytes
+} sweep_config_t;
+
+// Cache state established before each timed run
+typedef enum {
+    PRECONDITION_WARM,                 // Buffer pre-read into the caches
+    PRECONDITION_COLD,                 // Buffer lines flushed with clflushopt/clflush
+    PRECONDITION_EVICT,                // Eviction buffer larger than the LLC streamed through
+    PRECONDITION_DIRTY,                // Buffer lines written, held in Modified state
+    NUM_PRECONDITIONS
+} precondition_t;
+
+extern const char* precondition_names[NUM_PRECONDITIONS];
+
+// Latency histogram: log-bucketed like HdrHistogram, with
+// 2^HIST_SUB_BITS linear sub-buckets per power of two (~6% precision)
+#define HIST_SUB_BITS 4
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS 40               // Largest recordable value: 2^40 cycles
+#define HIST_BUCKETS ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+#define HIST_DISPLAY_GROUP 8           // Sub-buckets merged per ASCII row
+#define HIST_BAR_WIDTH 50
+
+typedef struct {
+    uint64_t counts[HIST_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+} latency_histogram_t;
+
+typedef struct {
+    int samples;                       // Timed batches per working-set size
+    int batch;                         // Dependent loads per timed batch
+    int csv;
+} histogram_options_t;
+
+// Results store: every steady-state loop is split into RESULT_SAMPLES
+// timed chunks so each row carries a sample set for significance tests
+#define RESULT_SAMPLES 7
+#define RESULT_FORMAT_VERSION 1
+
+typedef struct {
+    char test[16];
+    char params[64];
+    char metric[16];
+    double samples[RESULT_SAMPLES];
+    int num_samples;
+} result_row_t;
+
+typedef struct {
+    char cpu[64];
+    char microcode[32];
+    char kernel[160];
+    long l1d_size;
+    long l2_size;
+    long l3_size;
+    char fingerprint[17];              // FNV-1a of the fields above, hex
+} host_info_t;
+
+typedef struct {
+    host_info_t host;
+    char timestamp[32];
+    result_row_t* rows;
+    int num_rows;
+    int capacity;
+} result_set_t;
+
+// Startup profile: a fast pointer-chase sweep and bandwidth probe whose
+// output services read at startup to size tiles, batches and prefetching
+#define PROFILE_MAX_SIZE (64 * 1024 * 1024) // Sweep cap, keeps the profile under a second
+#define PROFILE_CHASE_LOADS 100000     // Dependent loads timed per size
+#define PROFILE_STREAM_BYTES (64 * 1024 * 1024) // Bytes streamed per bandwidth probe
+
+typedef struct {
+    int json;                          // JSON instead of key=value
+} profile_options_t;
+
+// Cache-blocking workloads: naive, tiled and recursive transpose and GEMM
+#define BLOCKING_MIN_TILE 8
+#define BLOCKING_MAX_TILE 512
+#define BLOCKING_BASE_CASE 32          // Recursive kernels stop splitting here
+
+typedef struct {
+    int transpose_n;                   // Square double matrix edge, transpose
+    int gemm_n;                        // Square double matrix edge, GEMM
+} blocking_options_t;
+
+typedef struct {
+    host_info_t host;
+    long cpus;
+    long line_size;
+    size_t l1d_size;                   // Capacities used for the recommendations:
+    size_t l2_size;                    // measured, capped at the OS-reported size
+    size_t l3_size;
+    double l1d_latency_ns;
+    double l2_latency_ns;
+    double l3_latency_ns;
+    double dram_latency_ns;            // Largest swept size when it stays in the LLC
+    double l1d_bandwidth;              // GB/s, one thread, sequential
+    double l2_bandwidth;
+    double dram_bandwidth;
+    size_t l1_tile_bytes;              // Half of L1d, room for other live data
+    int l1_tile_doubles;               // Square tile edge with three operand tiles
+    size_t l2_tile_bytes;
+    int l2_tile_doubles;
+    size_t hot_set_max;                // Largest working set before the LLC spills
+    int prefetch_lines;                // Latency x bandwidth, in cache lines
+    double elapsed_ms;
+} cachebench_profile_t;
+
+// Local file I/O: a temporary file the tool creates, reads and removes
+#define FILE_DEFAULT_SIZE (64 * 1024 * 1024)
+
+typedef struct {
+    const char* dir;                   // Temporary file directory; NULL for $TMPDIR or /var/tmp
+    size_t size;                       // Temporary file size
+} file_options_t;
+
+// Cache boundary detection
+#define MAX_CURVE_POINTS MAX_SWEEP_POINTS
+#define MAX_LEVELS 4                   // L1, L2, L3, DRAM
+#define LEVEL_STEP_RATIO 1.15          // Minimum latency step between two levels
+
+// One point of the latency-vs-size curve
+typedef struct {
+    size_t size;
+    double seq_ms;
+    double rand_ms;
+    double seq_ns;                     // ns per cache line, sequential sweep
+    double rand_ns;                    // ns per access, random sweep
+    double bandwidth;                  // GB/s, sequential sweep
+    int samples;
+} curve_point_t;
+
+// One detected level of the memory hierarchy
+typedef struct {
+    char name[8];
+    size_t first_size;
+    size_t capacity;                   // Largest working set still served at this level
+    double latency_ns;                 // Median random access cost on the plateau
+    double bandwidth;                  // Median sequential bandwidth on the plateau
+} cache_level_t;
+
+// Capacity of one cache level, for sizing workloads
+typedef struct {
+    char name[8];
+    size_t capacity;
+} level_limit_t;
+
+// CPU topology from sysfs, for pinning threads of concurrent tests
+#define MAX_CPUS 256
+#define SPIN_YIELD 128                 // Spins before a waiter yields the CPU
+
+typedef struct {
+    int cpu;
+    int core;                          // Physical core, unique across packages
+    int llc;                           // LLC domain (CCX): lowest CPU sharing the LLC
+    int package;
+} cpu_info_t;
+
+typedef struct {
+    int num_cpus;
+    cpu_info_t cpus[MAX_CPUS];
+} cpu_topology_t;
+
+typedef enum {
+    PLACEMENT_ANY,                     // Unpinned, wherever the scheduler puts them
+    PLACEMENT_SMT,                     // Hardware threads of one core
+    PLACEMENT_SAME_LLC,                // Distinct cores sharing one LLC
+    PLACEMENT_CROSS_LLC,               // Cores on different LLC domains of one package
+    PLACEMENT_CROSS_SOCKET,            // Cores on different packages
+    NUM_PLACEMENTS
+} placement_t;
+
+extern const char* placement_names[NUM_PLACEMENTS];
+
+// Hardware event counters (perf_event_open on Linux), counting the calling
+// thread in user mode. Often unavailable in VMs and containers.
+typedef enum {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_L1I_MISSES,
+    COUNTER_ITLB_MISSES,
+    NUM_COUNTERS
+} counter_event_t;
+
+extern const char* counter_names[NUM_COUNTERS];
+
+// Test registry
+#define MAX_TESTS 64
+#define TEST_IN_SUITE 0x1              // Part of the default full run
+
+typedef struct cachebench_context cachebench_context_t;
+
+typedef struct {
+    const char* name;
+    const char* description;
+    const char* params;                // Parameter space, for listings
+    const char* metrics;               // Result schema: metrics recorded per row
+    int flags;
+    void (*run)(cachebench_context_t* ctx);
+} cachebench_test_t;
+
+// Everything a test run reads and produces. Initialize with cachebench_init,
+// adjust the configuration, run tests, then read curve/results.
+struct cachebench_context {
+    // Configuration
+    FILE* out;                         // Report stream, NULL for silent runs
+    int iterations;                    // Base iteration count, NUM_ITERATIONS by default
+    int threads;                       // Concurrent tests: worker threads, 0 for one per online CPU
+    sweep_config_t latency_sweep;
+    sweep_config_t l3_sweep;
+    precondition_t precondition[MAX_TESTS]; // Per registered test
+    histogram_options_t histogram;
+    profile_options_t profile;
+    blocking_options_t blocking;
+    file_options_t file;
+
+    // Preconditioning mode of the running test
+    precondition_t mode;
+
+    // One pre-faulted buffer shared by every test. Tests use prefixes of it
+    // instead of allocating and zeroing per row.
+    struct {
+        char* base;
+        size_t size;
+        int locked;
+    } arena;
+
+    // Streamed by PRECONDITION_EVICT, allocated on first use
+    struct {
+        char* base;
+        size_t size;
+    } eviction;
+
+    // Measurements collected during the run, consumed by analyze_results
+    curve_point_t curve[MAX_CURVE_POINTS];
+    int num_points;
+    double line_stride_efficiency;     // CACHE_LINE_SIZE stride vs byte stride
+    result_set_t results;
+};
+
+// Context and registry
+void cachebench_init(cachebench_context_t* ctx);
+void cachebench_free(cachebench_context_t* ctx);
+int cachebench_register_test(const cachebench_test_t* test);
+int cachebench_num_tests();
+const cachebench_test_t* cachebench_get_test(int index);
+int cachebench_find_test(const char* name);
+int cachebench_run_test(cachebench_context_t* ctx, const char* name);
+void cachebench_run_suite(cachebench_context_t* ctx);
+void cachebench_printf(cachebench_context_t* ctx, const char* format, ...)
+    __attribute__((format(printf, 2, 3)));
+
+// High-resolution timer functions
+static inline uint64_t get_cycles() {
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+double get_time_ms();
+
+// Sizes and sweeps
+void format_size(size_t size, char* out, size_t len);
+int parse_size(const char* text, size_t* out);
+int parse_range(const char* text, sweep_config_t* sweep);
+int generate_sweep(const sweep_config_t* sweep, size_t* sizes, int max_sizes);
+
+// Arena and preconditioning
+int arena_init(cachebench_context_t* ctx, size_t size);
+void arena_destroy(cachebench_context_t* ctx);
+char* arena_buffer(cachebench_context_t* ctx, size_t size);
+size_t required_arena_size(const cachebench_context_t* ctx);
+void precondition_buffer(cachebench_context_t* ctx, void* buffer, size_t size, precondition_t mode);
+
+// Kernels
+typedef double (*line_kernel_t)(void* buffer, size_t size, int iterations);
+
+double benchmark_sequential_access(void* buffer, size_t size, int iterations);
+size_t* create_random_indices(size_t size);
+double benchmark_random_pattern(void* buffer, const size_t* indices, size_t size, int iterations);
+double benchmark_random_access(void* buffer, size_t size, int iterations);
+double benchmark_stride_access(void* buffer, size_t size, int stride, int iterations);
+double benchmark_write_access(void* buffer, size_t size, int iterations);
+double benchmark_associativity(void* buffer, size_t cache_size, int ways, int iterations);
+void** build_pointer_chain(void* buffer, size_t size);
+
+// Timed runs split into RESULT_SAMPLES chunks
+int chunk_iterations(int iterations, int chunk);
+double run_line_kernel(cachebench_context_t* ctx, line_kernel_t kernel, void* buffer, size_t size,
+                       int iterations, double* first_ns, double* samples);
+double run_random_kernel(cachebench_context_t* ctx, void* buffer, size_t size, int iterations,
+                         double* first_ns, double* samples);
+
+// Threads
+int worker_threads(const cachebench_context_t* ctx);
+int get_cpu_topology(cpu_topology_t* topo);
+int place_threads(const cpu_topology_t* topo, placement_t placement, int count, int* cpus);
+int pin_thread(int cpu);
+void spin_wait(int* spins);
+
+// Hardware counters
+int counter_open(counter_event_t event);
+void counter_start(int fd);
+uint64_t counter_stop(int fd);
+void counter_close(int fd);
+
+// Local files
+int create_bench_file(cachebench_context_t* ctx, char* path, size_t path_len);
+int evict_file(int fd, size_t size);
+
+// Latency histograms
+void histogram_record(latency_histogram_t* hist, uint64_t value);
+double histogram_percentile(const latency_histogram_t* hist, double percentile);
+uint64_t histogram_bucket_low(int bucket);
+uint64_t histogram_bucket_high(int bucket);
+double measure_tsc_ghz();
+uint64_t measure_timer_overhead();
+void sample_chase_latency(void** start, size_t num_lines, int samples, int batch,
+                          uint64_t overhead, int warm_up, latency_histogram_t* hist);
+
+// Startup profile
+int cachebench_profile(cachebench_context_t* ctx, cachebench_profile_t* profile);
+
+// Analysis
+void record_curve_point(cachebench_context_t* ctx, size_t size, double seq_ms, double rand_ms,
+                        int iterations);
+int detect_cache_levels(const curve_point_t* curve, int n, cache_level_t* levels);
+int get_cache_limits(cachebench_context_t* ctx, level_limit_t* limits, const char** source);
+void analyze_results(cachebench_context_t* ctx);
+
+// Results store
+void record_result(result_set_t* set, const char* test, const char* params,
+                   const char* metric, const double* samples, int num_samples);
+void free_results(result_set_t* set);
+double median_of_samples(const double* samples, int n);
+void get_host_info(host_info_t* host);
+int save_results(const result_set_t* set, const char* dir, char* path, size_t path_len);
+int load_results(const char* path, result_set_t* set);
+double mann_whitney_p(const double* a, int n1, const double* b, int n2);
+int compare_results(const result_set_t* base, const result_set_t* cand,
+                    double threshold_pct, double alpha, FILE* out);
+
+#endif
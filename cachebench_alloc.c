@@ -0,0 +1,377 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define ALLOC_MIN_SIZE 16
+#define ALLOC_MAX_SIZE (64 * 1024)
+#define ALLOC_BATCH 256                // Blocks live at once in the single-thread loop
+#define ALLOC_OPS (64 * 1024)          // Alloc/free pairs per sample and per producer
+#define ALLOC_WALK_BYTES (16 * 1024 * 1024) // Live bytes in the locality walk
+#define ALLOC_MAX_WALK_BLOCKS (256 * 1024)
+#define ALLOC_QUEUE_DEPTH 256          // Producer to consumer ring, a power of two
+#define ALLOC_HEADER 16                // Pool block header: owning pool, keeps 16-byte alignment
+
+typedef enum {
+    ALLOCATOR_MALLOC,                  // malloc/free: glibc, or whatever LD_PRELOAD supplies
+    ALLOCATOR_ARENA,                   // Bump pointer, free is a no-op, reset wholesale
+    ALLOCATOR_POOL,                    // Per-thread free lists, remote frees returned to the owner
+    NUM_ALLOCATORS
+} allocator_kind_t;
+
+static const char* allocator_names[NUM_ALLOCATORS] = {"malloc", "arena", "pool"};
+
+typedef struct pool_block {
+    struct pool_block* next;
+} pool_block_t;
+
+// One thread's allocator state for a single size class
+typedef struct allocator {
+    allocator_kind_t kind;
+    size_t size;                       // Bytes requested per block
+    size_t stride;                     // Bytes a block occupies in the chunk
+    char* chunk;                       // Arena and pool backing store
+    size_t capacity;
+    size_t used;
+    pool_block_t* free_list;           // Pool: blocks freed by the owner
+    _Atomic(pool_block_t*) remote;     // Pool: blocks freed by other threads
+} allocator_t;
+
+static volatile uint64_t alloc_sink;
+
+static size_t round_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+// Size the backing store for max_live blocks; malloc needs none
+static int allocator_init(allocator_t* a, allocator_kind_t kind, size_t size, size_t max_live) {
+    memset(a, 0, sizeof(*a));
+    a->kind = kind;
+    a->size = size;
+    if (kind == ALLOCATOR_MALLOC) return 0;
+
+    a->stride = round_up(size, 16) + (kind == ALLOCATOR_POOL ? ALLOC_HEADER : 0);
+    a->capacity = round_up(max_live * a->stride, 4096);
+    a->chunk = aligned_alloc(4096, a->capacity);
+    atomic_init(&a->remote, NULL);
+    return a->chunk ? 0 : -1;
+}
+
+static void allocator_destroy(allocator_t* a) {
+    free(a->chunk);
+    a->chunk = NULL;
+}
+
+static inline void* allocator_alloc(allocator_t* a) {
+    switch (a->kind) {
+    case ALLOCATOR_MALLOC:
+        return malloc(a->size);
+    case ALLOCATOR_ARENA: {
+        // Wraps when full; callers size the store for every block they
+        // allocate before a reset, live or not
+        if (a->used + a->stride > a->capacity) a->used = 0;
+        void* p = a->chunk + a->used;
+        a->used += a->stride;
+        return p;
+    }
+    default: {
+        pool_block_t* block = a->free_list;
+        if (!block) block = atomic_exchange_explicit(&a->remote, NULL, memory_order_acquire);
+        if (block) {
+            a->free_list = block->next;
+        } else {
+            if (a->used + a->stride > a->capacity) return NULL;
+            block = (pool_block_t*)(a->chunk + a->used);
+            a->used += a->stride;
+        }
+        *(allocator_t**)block = a;
+        return (char*)block + ALLOC_HEADER;
+    }
+    }
+}
+
+// Free p from the thread owning self
+static inline void allocator_free(allocator_t* self, void* p) {
+    switch (self->kind) {
+    case ALLOCATOR_MALLOC:
+        free(p);
+        break;
+    case ALLOCATOR_ARENA:
+        break;
+    default: {
+        pool_block_t* block = (pool_block_t*)((char*)p - ALLOC_HEADER);
+        allocator_t* owner = *(allocator_t**)block;
+        if (owner == self) {
+            block->next = self->free_list;
+            self->free_list = block;
+        } else {
+            pool_block_t* head = atomic_load_explicit(&owner->remote, memory_order_relaxed);
+            do {
+                block->next = head;
+            } while (!atomic_compare_exchange_weak_explicit(&owner->remote, &head, block,
+                                                            memory_order_release,
+                                                            memory_order_relaxed));
+        }
+        break;
+    }
+    }
+}
+
+// The arena frees in bulk once everything from it is dead
+static inline void allocator_reset(allocator_t* a) {
+    if (a->kind == ALLOCATOR_ARENA) a->used = 0;
+}
+
+// ns per alloc/free pair: ALLOC_BATCH allocations, each written, then freed
+// in allocation order
+static double time_alloc_free(allocator_t* a, void** blocks) {
+    uint64_t sum = 0;
+    double start_time = get_time_ms();
+    for (int round = 0; round < ALLOC_OPS / ALLOC_BATCH; round++) {
+        for (int i = 0; i < ALLOC_BATCH; i++) {
+            blocks[i] = allocator_alloc(a);
+            *(uint64_t*)blocks[i] = i;
+        }
+        for (int i = 0; i < ALLOC_BATCH; i++) {
+            sum += *(uint64_t*)blocks[i];
+            allocator_free(a, blocks[i]);
+        }
+        allocator_reset(a);
+    }
+    double ms = get_time_ms() - start_time;
+    alloc_sink = sum;
+    return ms * 1e6 / ALLOC_OPS;
+}
+
+// Age a heap of count live blocks by freeing a random half and allocating
+// it again, link the survivors in allocation order, then chase the links.
+// Returns ns per block visited, or -1 if the chain did not reach every block.
+static double time_block_walk(cachebench_context_t* ctx, allocator_t* a, void** blocks, size_t count) {
+    for (size_t i = 0; i < count; i++) blocks[i] = allocator_alloc(a);
+
+    // Move the freed blocks to the end so allocation order stays the array order
+    size_t kept = 0, freed = 0;
+    void** reallocated = blocks + count;
+    for (size_t i = 0; i < count; i++) {
+        if (rand() & 1) {
+            allocator_free(a, blocks[i]);
+            freed++;
+        } else {
+            blocks[kept++] = blocks[i];
+        }
+    }
+    for (size_t i = 0; i < freed; i++) reallocated[i] = allocator_alloc(a);
+    memmove(blocks + kept, reallocated, freed * sizeof(void*));
+
+    for (size_t i = 0; i < count; i++) {
+        *(void**)blocks[i] = i + 1 < count ? blocks[i + 1] : NULL;
+    }
+
+    // Blocks are scattered through the heap, so precondition each one;
+    // eviction is global and runs once
+    if (ctx->mode == PRECONDITION_EVICT) {
+        precondition_buffer(ctx, NULL, 0, ctx->mode);
+    } else {
+        for (size_t i = 0; i < count; i++) precondition_buffer(ctx, blocks[i], a->size, ctx->mode);
+    }
+    double start_time = get_time_ms();
+    void** p = (void**)blocks[0];
+    size_t visited = 0;
+    while (p) {
+        p = (void**)*p;
+        visited++;
+    }
+    double ms = get_time_ms() - start_time;
+    alloc_sink = visited;
+
+    for (size_t i = 0; i < count; i++) allocator_free(a, blocks[i]);
+    allocator_reset(a);
+    return visited == count ? ms * 1e6 / count : -1;
+}
+
+// Single-producer, single-consumer ring carrying blocks between threads
+typedef struct {
+    void* slots[ALLOC_QUEUE_DEPTH];
+    _Atomic size_t head;               // Next slot the consumer reads
+    _Atomic size_t tail;               // Next slot the producer writes
+} alloc_queue_t;
+
+typedef struct {
+    alloc_queue_t queue;
+    allocator_t producer;
+    allocator_t consumer;
+    _Atomic int* start;
+    uint64_t sum;
+} alloc_pair_t;
+
+static void wait_for_start(_Atomic int* start) {
+    while (!atomic_load_explicit(start, memory_order_acquire)) sched_yield();
+}
+
+static void* producer_thread(void* arg) {
+    alloc_pair_t* pair = arg;
+    alloc_queue_t* q = &pair->queue;
+    wait_for_start(pair->start);
+
+    for (size_t i = 0; i < ALLOC_OPS; i++) {
+        void* p = allocator_alloc(&pair->producer);
+        *(uint64_t*)p = i;
+
+        size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        while (tail - atomic_load_explicit(&q->head, memory_order_acquire) == ALLOC_QUEUE_DEPTH) {
+            sched_yield();
+        }
+        q->slots[tail % ALLOC_QUEUE_DEPTH] = p;
+        atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+    }
+    return NULL;
+}
+
+static void* consumer_thread(void* arg) {
+    alloc_pair_t* pair = arg;
+    alloc_queue_t* q = &pair->queue;
+    wait_for_start(pair->start);
+
+    uint64_t sum = 0;
+    for (size_t i = 0; i < ALLOC_OPS; i++) {
+        size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+        while (atomic_load_explicit(&q->tail, memory_order_acquire) == head) sched_yield();
+        void* p = q->slots[head % ALLOC_QUEUE_DEPTH];
+        atomic_store_explicit(&q->head, head + 1, memory_order_release);
+
+        sum += *(uint64_t*)p;
+        allocator_free(&pair->consumer, p);
+    }
+    pair->sum = sum;
+    return NULL;
+}
+
+// ns per block handed across threads, over all pairs together; -1 when
+// threads or memory are unavailable
+static double time_cross_thread(allocator_kind_t kind, size_t size, int pairs) {
+    alloc_pair_t* pair_state = calloc(pairs, sizeof(alloc_pair_t));
+    pthread_t* threads = calloc(2 * pairs, sizeof(pthread_t));
+    _Atomic int start;
+    atomic_init(&start, 0);
+
+    int created = 0, ok = pair_state && threads;
+    for (int p = 0; ok && p < pairs; p++) {
+        // Live blocks are bounded by the ring plus one in each thread's hands
+        ok = allocator_init(&pair_state[p].producer, kind, size, 2 * ALLOC_QUEUE_DEPTH + 2) == 0 &&
+             allocator_init(&pair_state[p].consumer, kind, size, 1) == 0;
+        pair_state[p].start = &start;
+    }
+    for (int p = 0; ok && p < pairs; p++) {
+        ok = pthread_create(&threads[created], NULL, producer_thread, &pair_state[p]) == 0;
+        if (ok) created++;
+        if (ok) ok = pthread_create(&threads[created], NULL, consumer_thread, &pair_state[p]) == 0;
+        if (ok) created++;
+    }
+
+    double start_time = get_time_ms();
+    atomic_store_explicit(&start, 1, memory_order_release);
+    for (int t = 0; t < created; t++) pthread_join(threads[t], NULL);
+    double ms = get_time_ms() - start_time;
+
+    for (int p = 0; pair_state && p < pairs; p++) {
+        allocator_destroy(&pair_state[p].producer);
+        allocator_destroy(&pair_state[p].consumer);
+    }
+    free(pair_state);
+    free(threads);
+    return ok ? ms * 1e6 / ((double)ALLOC_OPS * pairs) : -1;
+}
+
+static void run_alloc_test(cachebench_context_t* ctx) {
+    int pairs = worker_threads(ctx) / 2;
+    if (pairs < 1) pairs = 1;
+
+    void** blocks = malloc(2 * ALLOC_MAX_WALK_BLOCKS * sizeof(void*));
+    if (!blocks) {
+        cachebench_printf(ctx, "Failed to allocate memory for alloc test\n");
+        return;
+    }
+
+    const char* preload = getenv("LD_PRELOAD");
+    cachebench_printf(ctx, "=== Allocator Throughput and Locality ===\n");
+    cachebench_printf(ctx, "malloc: %s%s; arena: bump pointer; pool: per-thread free lists\n",
+                      preload && *preload ? "LD_PRELOAD=" : "system allocator",
+                      preload && *preload ? preload : "");
+    cachebench_printf(ctx, "Alloc+free: ns per pair, %d live blocks; walk: ns per block over an "
+                      "aged %d MB heap;\ncross-thread: Mops/s with %d producer/consumer pair%s\n",
+                      ALLOC_BATCH, ALLOC_WALK_BYTES / (1024 * 1024), pairs, pairs == 1 ? "" : "s");
+    cachebench_printf(ctx, "Size\t\tAlloc+free: malloc\tarena\tpool\tWalk: malloc\tarena\tpool\tXthread: malloc\tarena\tpool\n");
+    cachebench_printf(ctx, "-------------------------------------------------------------------------------------------------------------------------\n");
+
+    for (size_t size = ALLOC_MIN_SIZE; size <= ALLOC_MAX_SIZE; size *= 4) {
+        size_t walk_blocks = ALLOC_WALK_BYTES / size;
+        if (walk_blocks > ALLOC_MAX_WALK_BLOCKS) walk_blocks = ALLOC_MAX_WALK_BLOCKS;
+
+        double pair_ns[NUM_ALLOCATORS], walk_ns[NUM_ALLOCATORS], xthread_ns[NUM_ALLOCATORS];
+        for (int k = 0; k < NUM_ALLOCATORS; k++) {
+            allocator_t a;
+            // The walk allocates every block, then up to all of them again:
+            // the arena never reuses the freed ones
+            if (allocator_init(&a, k, size, 2 * walk_blocks + ALLOC_BATCH) != 0) {
+                cachebench_printf(ctx, "Failed to allocate %s backing store\n", allocator_names[k]);
+                free(blocks);
+                return;
+            }
+
+            double pair_samples[RESULT_SAMPLES], walk_samples[RESULT_SAMPLES];
+            double xthread_samples[RESULT_SAMPLES];
+            pair_ns[k] = walk_ns[k] = xthread_ns[k] = 0;
+            int walk_failed = 0;
+            for (int s = 0; s < RESULT_SAMPLES; s++) {
+                pair_samples[s] = time_alloc_free(&a, blocks);
+                walk_samples[s] = time_block_walk(ctx, &a, blocks, walk_blocks);
+                walk_failed |= walk_samples[s] < 0;
+                xthread_samples[s] = time_cross_thread(k, size, pairs);
+                pair_ns[k] += pair_samples[s] / RESULT_SAMPLES;
+                walk_ns[k] += walk_samples[s] / RESULT_SAMPLES;
+                xthread_ns[k] += xthread_samples[s] / RESULT_SAMPLES;
+            }
+            allocator_destroy(&a);
+            if (walk_failed) walk_ns[k] = -1;
+
+            char params[64];
+            snprintf(params, sizeof(params), "size=%zu,allocator=%s,mode=%s",
+                     size, allocator_names[k], precondition_names[ctx->mode]);
+            record_result(&ctx->results, "alloc", params, "pair_ns", pair_samples, RESULT_SAMPLES);
+            if (!walk_failed) {
+                record_result(&ctx->results, "alloc", params, "walk_ns", walk_samples, RESULT_SAMPLES);
+            }
+            if (xthread_ns[k] > 0) {
+                snprintf(params, sizeof(params), "size=%zu,allocator=%s,pairs=%d",
+                         size, allocator_names[k], pairs);
+                record_result(&ctx->results, "alloc", params, "xthread_ns", xthread_samples,
+                              RESULT_SAMPLES);
+            }
+        }
+
+        char size_label[32];
+        format_size(size, size_label, sizeof(size_label));
+        cachebench_printf(ctx, "%-9s\t%.1f\t\t\t%.1f\t%.1f", size_label, pair_ns[ALLOCATOR_MALLOC],
+                          pair_ns[ALLOCATOR_ARENA], pair_ns[ALLOCATOR_POOL]);
+        // A walk that lost blocks has no meaningful per-block cost
+        for (int k = 0; k < NUM_ALLOCATORS; k++) {
+            const char* gap = k == ALLOCATOR_MALLOC ? "\t" : "";
+            if (walk_ns[k] < 0) cachebench_printf(ctx, "\tn/a%s", gap);
+            else cachebench_printf(ctx, "\t%.2f%s", walk_ns[k], gap);
+        }
+        cachebench_printf(ctx, "\t%.2f\t\t%.2f\t%.2f\n", 1e3 / xthread_ns[ALLOCATOR_MALLOC],
+                          1e3 / xthread_ns[ALLOCATOR_ARENA], 1e3 / xthread_ns[ALLOCATOR_POOL]);
+    }
+
+    free(blocks);
+    cachebench_printf(ctx, "\n");
+}
+
+const cachebench_test_t alloc_test = {
+    "alloc", "malloc vs bump arena vs per-thread pools: alloc/free cost, locality, cross-thread frees",
+    "size=16..64K,allocator=malloc|arena|pool,pairs=threads/2", "pair_ns, walk_ns, xthread_ns",
+    0, run_alloc_test
+};
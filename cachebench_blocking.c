@@ -0,0 +1,307 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+typedef struct {
+    const char* variant;
+    int tile;                          // 0 for naive
+    size_t footprint;                  // Bytes the innermost block keeps live
+    double ms;                         // Median of RESULT_SAMPLES runs
+} blocking_row_t;
+
+static inline int min_int(int a, int b) {
+    return a < b ? a : b;
+}
+
+static const char* fitting_level(const level_limit_t* limits, int count, size_t bytes) {
+    for (int l = 0; l < count; l++) {
+        if (bytes <= limits[l].capacity) return limits[l].name;
+    }
+    return "DRAM";
+}
+
+static void transpose_naive(const double* a, double* b, int n) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            b[(size_t)j * n + i] = a[(size_t)i * n + j];
+        }
+    }
+}
+
+static void transpose_tiled(const double* a, double* b, int n, int tile) {
+    for (int ii = 0; ii < n; ii += tile) {
+        for (int jj = 0; jj < n; jj += tile) {
+            int i_end = min_int(ii + tile, n), j_end = min_int(jj + tile, n);
+            for (int i = ii; i < i_end; i++) {
+                for (int j = jj; j < j_end; j++) {
+                    b[(size_t)j * n + i] = a[(size_t)i * n + j];
+                }
+            }
+        }
+    }
+}
+
+// Cache-oblivious: halve the longer side until the block is small enough
+// to transpose directly, whatever the cache sizes are
+static void transpose_recursive(const double* a, double* b, int n,
+                                int i0, int j0, int rows, int cols) {
+    if (rows <= BLOCKING_BASE_CASE && cols <= BLOCKING_BASE_CASE) {
+        for (int i = i0; i < i0 + rows; i++) {
+            for (int j = j0; j < j0 + cols; j++) {
+                b[(size_t)j * n + i] = a[(size_t)i * n + j];
+            }
+        }
+    } else if (rows >= cols) {
+        int half = rows / 2;
+        transpose_recursive(a, b, n, i0, j0, half, cols);
+        transpose_recursive(a, b, n, i0 + half, j0, rows - half, cols);
+    } else {
+        int half = cols / 2;
+        transpose_recursive(a, b, n, i0, j0, rows, half);
+        transpose_recursive(a, b, n, i0, j0 + half, rows, cols - half);
+    }
+}
+
+// C = A * B, textbook i-j-k order: B is walked down its columns
+static void gemm_naive(const double* a, const double* b, double* c, int n) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double sum = 0;
+            for (int k = 0; k < n; k++) {
+                sum += a[(size_t)i * n + k] * b[(size_t)k * n + j];
+            }
+            c[(size_t)i * n + j] = sum;
+        }
+    }
+}
+
+// i-k-j order inside tile x tile blocks of all three matrices
+static void gemm_block(const double* a, const double* b, double* c, int n,
+                       int i0, int i1, int k0, int k1, int j0, int j1) {
+    for (int i = i0; i < i1; i++) {
+        for (int k = k0; k < k1; k++) {
+            double aik = a[(size_t)i * n + k];
+            for (int j = j0; j < j1; j++) {
+                c[(size_t)i * n + j] += aik * b[(size_t)k * n + j];
+            }
+        }
+    }
+}
+
+static void gemm_tiled(const double* a, const double* b, double* c, int n, int tile) {
+    for (int ii = 0; ii < n; ii += tile) {
+        for (int kk = 0; kk < n; kk += tile) {
+            for (int jj = 0; jj < n; jj += tile) {
+                gemm_block(a, b, c, n, ii, min_int(ii + tile, n), kk, min_int(kk + tile, n),
+                           jj, min_int(jj + tile, n));
+            }
+        }
+    }
+}
+
+// Cache-oblivious: halve the largest of the three dimensions
+static void gemm_recursive(const double* a, const double* b, double* c, int n,
+                           int i0, int rows, int k0, int depth, int j0, int cols) {
+    if (rows <= BLOCKING_BASE_CASE && depth <= BLOCKING_BASE_CASE && cols <= BLOCKING_BASE_CASE) {
+        gemm_block(a, b, c, n, i0, i0 + rows, k0, k0 + depth, j0, j0 + cols);
+    } else if (rows >= depth && rows >= cols) {
+        int half = rows / 2;
+        gemm_recursive(a, b, c, n, i0, half, k0, depth, j0, cols);
+        gemm_recursive(a, b, c, n, i0 + half, rows - half, k0, depth, j0, cols);
+    } else if (cols >= depth) {
+        int half = cols / 2;
+        gemm_recursive(a, b, c, n, i0, rows, k0, depth, j0, half);
+        gemm_recursive(a, b, c, n, i0, rows, k0, depth, j0 + half, cols - half);
+    } else {
+        int half = depth / 2;
+        gemm_recursive(a, b, c, n, i0, rows, k0, half, j0, cols);
+        gemm_recursive(a, b, c, n, i0, rows, k0 + half, depth - half, j0, cols);
+    }
+}
+
+static void fill_matrix(double* m, int n, int seed) {
+    for (size_t i = 0; i < (size_t)n * n; i++) {
+        m[i] = (double)((i * 7 + seed) % 13) - 6.0;
+    }
+}
+
+static double checksum(const double* m, int n) {
+    double sum = 0;
+    for (size_t i = 0; i < (size_t)n * n; i++) sum += m[i] * (double)(i % 31 + 1);
+    return sum;
+}
+
+// Run one transpose variant RESULT_SAMPLES times and return the median ms;
+// tile 0 is naive, -1 recursive
+static double time_transpose(cachebench_context_t* ctx, const double* a, double* b, int n,
+                             int tile, double* samples) {
+    size_t bytes = (size_t)n * n * sizeof(double);
+    for (int s = 0; s < RESULT_SAMPLES; s++) {
+        precondition_buffer(ctx, (void*)a, 2 * bytes, ctx->mode);
+        double start_time = get_time_ms();
+        if (tile == 0) transpose_naive(a, b, n);
+        else if (tile < 0) transpose_recursive(a, b, n, 0, 0, n, n);
+        else transpose_tiled(a, b, n, tile);
+        samples[s] = get_time_ms() - start_time;
+    }
+    return median_of_samples(samples, RESULT_SAMPLES);
+}
+
+// Same for GEMM; C is cleared after preconditioning the inputs
+static double time_gemm(cachebench_context_t* ctx, const double* a, const double* b, double* c,
+                        int n, int tile, double* samples) {
+    size_t bytes = (size_t)n * n * sizeof(double);
+    for (int s = 0; s < RESULT_SAMPLES; s++) {
+        precondition_buffer(ctx, (void*)a, 2 * bytes, ctx->mode);
+        memset(c, 0, bytes);
+        double start_time = get_time_ms();
+        if (tile == 0) gemm_naive(a, b, c, n);
+        else if (tile < 0) gemm_recursive(a, b, c, n, 0, n, 0, n, 0, n);
+        else gemm_tiled(a, b, c, n, tile);
+        samples[s] = get_time_ms() - start_time;
+    }
+    return median_of_samples(samples, RESULT_SAMPLES);
+}
+
+static void print_blocking_rows(cachebench_context_t* ctx, const blocking_row_t* rows, int count,
+                                const level_limit_t* limits, int num_limits,
+                                double work, const char* unit) {
+    cachebench_printf(ctx, "Variant\t\tTile\tFootprint\tFits\tTime (ms)\t%s\t\tvs Naive\n", unit);
+    cachebench_printf(ctx, "--------------------------------------------------------------------------------\n");
+
+    int best = 0;
+    for (int r = 0; r < count; r++) {
+        char tile[16], footprint[32];
+        if (rows[r].tile > 0) snprintf(tile, sizeof(tile), "%d", rows[r].tile);
+        else if (rows[r].tile < 0) snprintf(tile, sizeof(tile), "<=%d", BLOCKING_BASE_CASE);
+        else snprintf(tile, sizeof(tile), "-");
+        if (rows[r].footprint) format_size(rows[r].footprint, footprint, sizeof(footprint));
+        else snprintf(footprint, sizeof(footprint), "-");
+
+        cachebench_printf(ctx, "%-9s\t%s\t%s\t\t%s\t%.2f\t\t%.2f\t\t%.2fx\n", rows[r].variant, tile,
+                          footprint, rows[r].footprint ?
+                          fitting_level(limits, num_limits, rows[r].footprint) : "-",
+                          rows[r].ms, work / (rows[r].ms * 1e6), rows[0].ms / rows[r].ms);
+        if (rows[r].ms < rows[best].ms) best = r;
+    }
+
+    char footprint[32];
+    format_size(rows[best].footprint, footprint, sizeof(footprint));
+    if (rows[best].tile > 0) {
+        cachebench_printf(ctx, "Best: tile %d (%s, fits %s), %.2f %s, %.2fx naive\n\n",
+                          rows[best].tile, footprint,
+                          fitting_level(limits, num_limits, rows[best].footprint),
+                          work / (rows[best].ms * 1e6), unit, rows[0].ms / rows[best].ms);
+    } else {
+        cachebench_printf(ctx, "Best: %s, %.2f %s, %.2fx naive\n\n", rows[best].variant,
+                          work / (rows[best].ms * 1e6), unit, rows[0].ms / rows[best].ms);
+    }
+}
+
+static void record_blocking(cachebench_context_t* ctx, const char* kernel, const char* variant,
+                            int tile, int n, const double* samples) {
+    char params[64];
+    snprintf(params, sizeof(params), "kernel=%s,variant=%s,tile=%d,n=%d,mode=%s",
+             kernel, variant, tile, n, precondition_names[ctx->mode]);
+    record_result(&ctx->results, "blocking", params, "ms", samples, RESULT_SAMPLES);
+}
+
+static void run_blocking_test(cachebench_context_t* ctx) {
+    level_limit_t limits[MAX_LEVELS];
+    const char* source;
+    int num_limits = get_cache_limits(ctx, limits, &source);
+
+    cachebench_printf(ctx, "=== Cache Blocking: Transpose and GEMM ===\n");
+    cachebench_printf(ctx, "Cache sizes (%s):", source);
+    for (int l = 0; l < num_limits; l++) {
+        char size[32];
+        format_size(limits[l].capacity, size, sizeof(size));
+        cachebench_printf(ctx, " %s %s", limits[l].name, size);
+    }
+    cachebench_printf(ctx, "\nFootprint: bytes the innermost block keeps live; %s preconditioning\n\n",
+                      precondition_names[ctx->mode]);
+
+    blocking_row_t rows[16];
+    double samples[RESULT_SAMPLES];
+
+    // Transpose: every element read once and written once
+    int n = ctx->blocking.transpose_n;
+    size_t matrix = (size_t)n * n * sizeof(double);
+    char* buffer = arena_buffer(ctx, matrix * 2);
+    if (!buffer) return;
+    double* a = (double*)buffer;
+    double* b = (double*)(buffer + matrix);
+    fill_matrix(a, n, 1);
+
+    char size[32];
+    format_size(matrix, size, sizeof(size));
+    cachebench_printf(ctx, "--- Transpose, %dx%d doubles (%s per matrix) ---\n", n, n, size);
+
+    int count = 0, mismatch = 0;
+    rows[count++] = (blocking_row_t){"naive", 0, 0, time_transpose(ctx, a, b, n, 0, samples)};
+    record_blocking(ctx, "transpose", "naive", 0, n, samples);
+    double expected = checksum(b, n);
+
+    // B is cleared before each variant so elements it skips cannot keep the
+    // previous variant's values
+    for (int tile = BLOCKING_MIN_TILE; tile <= BLOCKING_MAX_TILE && tile <= n; tile *= 2) {
+        memset(b, 0, matrix);
+        double ms = time_transpose(ctx, a, b, n, tile, samples);
+        rows[count++] = (blocking_row_t){"tiled", tile, 2 * (size_t)tile * tile * sizeof(double), ms};
+        record_blocking(ctx, "transpose", "tiled", tile, n, samples);
+        mismatch |= checksum(b, n) != expected;
+    }
+    memset(b, 0, matrix);
+    rows[count++] = (blocking_row_t){"recursive", -1,
+                                     2 * (size_t)BLOCKING_BASE_CASE * BLOCKING_BASE_CASE * sizeof(double),
+                                     time_transpose(ctx, a, b, n, -1, samples)};
+    record_blocking(ctx, "transpose", "recursive", BLOCKING_BASE_CASE, n, samples);
+    mismatch |= checksum(b, n) != expected;
+    if (mismatch) cachebench_printf(ctx, "⚠ Transpose variants disagree\n");
+
+    print_blocking_rows(ctx, rows, count, limits, num_limits, 2.0 * matrix, "GB/s");
+
+    // GEMM: 2n^3 flops
+    n = ctx->blocking.gemm_n;
+    matrix = (size_t)n * n * sizeof(double);
+    buffer = arena_buffer(ctx, matrix * 3);
+    if (!buffer) return;
+    a = (double*)buffer;
+    b = (double*)(buffer + matrix);
+    double* c = (double*)(buffer + 2 * matrix);
+    fill_matrix(a, n, 1);
+    fill_matrix(b, n, 5);
+
+    format_size(matrix, size, sizeof(size));
+    cachebench_printf(ctx, "--- GEMM, %dx%d doubles (%s per matrix) ---\n", n, n, size);
+
+    count = 0;
+    rows[count++] = (blocking_row_t){"naive", 0, 0, time_gemm(ctx, a, b, c, n, 0, samples)};
+    record_blocking(ctx, "gemm", "naive", 0, n, samples);
+    expected = checksum(c, n);
+
+    mismatch = 0;
+    for (int tile = BLOCKING_MIN_TILE; tile <= BLOCKING_MAX_TILE && tile <= n; tile *= 2) {
+        double ms = time_gemm(ctx, a, b, c, n, tile, samples);
+        rows[count++] = (blocking_row_t){"tiled", tile, 3 * (size_t)tile * tile * sizeof(double), ms};
+        record_blocking(ctx, "gemm", "tiled", tile, n, samples);
+        mismatch |= fabs(checksum(c, n) - expected) > 1e-9 * fabs(expected);
+    }
+    rows[count++] = (blocking_row_t){"recursive", -1,
+                                     3 * (size_t)BLOCKING_BASE_CASE * BLOCKING_BASE_CASE * sizeof(double),
+                                     time_gemm(ctx, a, b, c, n, -1, samples)};
+    record_blocking(ctx, "gemm", "recursive", BLOCKING_BASE_CASE, n, samples);
+    mismatch |= fabs(checksum(c, n) - expected) > 1e-9 * fabs(expected);
+    if (mismatch) cachebench_printf(ctx, "⚠ GEMM variants disagree\n");
+
+    // GFLOP/s from the same work / (ms * 1e6) expression, with work in flops
+    print_blocking_rows(ctx, rows, count, limits, num_limits, 2.0 * n * n * n, "GFLOP/s");
+}
+
+const cachebench_test_t blocking_test = {
+    "blocking", "Naive, tiled and cache-oblivious transpose and GEMM",
+    "kernel=transpose|gemm,variant=naive|tiled|recursive,tile=8..512,n", "ms",
+    TEST_IN_SUITE, run_blocking_test
+};
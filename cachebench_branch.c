@@ -0,0 +1,300 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#define BRANCH_EXECUTIONS (1 << 20)    // Branches executed per timed sample
+#define BRANCH_MAX_STATIC (64 * 1024)  // Largest number of distinct conditional branches
+#define BRANCH_MAX_PERIOD 8192
+#define BRANCH_RANDOM_ROWS (64 * 1024) // "Random" patterns repeat only after this many rows
+#define BRANCH_CAPACITY_PERIOD 4       // Per-branch pattern period in the capacity sweep
+#define BRANCH_OUTCOME_BYTES (1024 * 1024)
+#define BRANCH_MAX_TARGETS 64
+#define BRANCH_SELECTORS (64 * 1024)   // Indirect call target sequence length
+
+// Generated block per static branch, 16 bytes:
+//   nop
+//   movzx eax, byte [rdi + k]        outcome of branch k in this row
+//   test eax, eax
+//   jz +4
+//   add rcx, 1
+#define BRANCH_BLOCK 16
+static const unsigned char block_template[BRANCH_BLOCK] = {
+    0x90,
+    0x0F, 0xB6, 0x87, 0, 0, 0, 0,
+    0x85, 0xC0,
+    0x74, 0x04,
+    0x48, 0x83, 0xC1, 0x01,
+};
+#define BLOCK_DISP_OFFSET 4
+#define OP_RET 0xC3
+
+// Called with one row of outcome bytes, one per static branch
+typedef void (*branch_fn_t)(const uint8_t* row);
+
+// Write n branch blocks and a ret; returns 0, or -1 when the region cannot
+// be made writable and then executable
+static int generate_branches(unsigned char* code, size_t region, int n) {
+#ifdef _WIN32
+    return -1;
+#else
+    if (mprotect(code, region, PROT_READ | PROT_WRITE) != 0) return -1;
+    for (int k = 0; k < n; k++) {
+        unsigned char* block = code + (size_t)k * BRANCH_BLOCK;
+        int32_t disp = k;
+        memcpy(block, block_template, BRANCH_BLOCK);
+        memcpy(block + BLOCK_DISP_OFFSET, &disp, sizeof(disp));
+    }
+    code[(size_t)n * BRANCH_BLOCK] = OP_RET;
+    return mprotect(code, region, PROT_READ | PROT_EXEC);
+#endif
+}
+
+// rows x n outcomes: each branch gets its own random sequence of length
+// rows, taken with probability taken_pct
+static void fill_outcomes(uint8_t* outcomes, int n, int rows, int taken_pct) {
+    for (size_t i = 0; i < (size_t)n * rows; i++) {
+        outcomes[i] = rand() % 100 < taken_pct;
+    }
+}
+
+typedef struct {
+    double cycles;                     // TSC cycles per branch, median
+    double miss_rate;                  // Mispredicts per branch, -1 without counters
+} branch_point_t;
+
+// Execute the n generated branches over rows outcome rows, BRANCH_EXECUTIONS
+// branches per sample, after one warm-up sample
+static branch_point_t time_branches(branch_fn_t fn, const uint8_t* outcomes, int n, int rows,
+                                    int miss_fd, double* samples) {
+    size_t calls = BRANCH_EXECUTIONS / n;
+    if (calls < 1) calls = 1;
+    uint64_t misses = 0;
+
+    for (int s = -1; s < RESULT_SAMPLES; s++) {
+        int row = 0;
+        if (s == 0) counter_start(miss_fd);
+        uint64_t start = get_cycles();
+        for (size_t c = 0; c < calls; c++) {
+            fn(outcomes + (size_t)row * n);
+            if (++row == rows) row = 0;
+        }
+        double cycles = (double)(get_cycles() - start) / ((double)calls * n);
+        if (s >= 0) samples[s] = cycles;
+    }
+    misses = counter_stop(miss_fd);
+
+    branch_point_t point;
+    point.cycles = median_of_samples(samples, RESULT_SAMPLES);
+    point.miss_rate = miss_fd >= 0 ? (double)misses / ((double)calls * n * RESULT_SAMPLES) : -1;
+    return point;
+}
+
+static void print_miss_rate(cachebench_context_t* ctx, double miss_rate) {
+    if (miss_rate >= 0) cachebench_printf(ctx, "\t%.1f%%", miss_rate * 100);
+    cachebench_printf(ctx, "\n");
+}
+
+// One static branch: repeating random patterns of growing period, then
+// random outcomes of decreasing bias. Returns TSC cycles per mispredict.
+static double run_pattern_sweep(cachebench_context_t* ctx, unsigned char* code, size_t region,
+                                uint8_t* outcomes, int miss_fd) {
+    const char* miss_header = miss_fd >= 0 ? "\tMispredicts" : "";
+    cachebench_printf(ctx, "One branch, random pattern repeating every P outcomes (cycles/branch)\n");
+    cachebench_printf(ctx, "Pattern\t\tCycles\tExtra%s\n", miss_header);
+    cachebench_printf(ctx, "--------------------------------------------\n");
+
+    if (generate_branches(code, region, 1) != 0) return -1;
+    branch_fn_t fn = (branch_fn_t)(void*)code;
+
+    double always = 0;
+    for (int period = 1; period <= BRANCH_MAX_PERIOD; period *= 2) {
+        // Period 1: always taken
+        if (period == 1) memset(outcomes, 1, 1);
+        else fill_outcomes(outcomes, 1, period, 50);
+
+        double samples[RESULT_SAMPLES];
+        branch_point_t point = time_branches(fn, outcomes, 1, period, miss_fd, samples);
+        if (period == 1) always = point.cycles;
+
+        char params[64];
+        snprintf(params, sizeof(params), "kind=pattern,period=%d", period);
+        record_result(&ctx->results, "branch", params, "cycles", samples, RESULT_SAMPLES);
+
+        cachebench_printf(ctx, "P=%d\t\t%.2f\t%.2f", period, point.cycles, point.cycles - always);
+        print_miss_rate(ctx, point.miss_rate);
+    }
+
+    int biases[] = {99, 90, 75, 50};
+    int num_biases = sizeof(biases) / sizeof(biases[0]);
+    double mispredict = -1;
+    for (int b = 0; b < num_biases; b++) {
+        fill_outcomes(outcomes, 1, BRANCH_RANDOM_ROWS, biases[b]);
+        double samples[RESULT_SAMPLES];
+        branch_point_t point = time_branches(fn, outcomes, 1, BRANCH_RANDOM_ROWS, miss_fd, samples);
+
+        char params[64];
+        snprintf(params, sizeof(params), "kind=random,taken=%d", biases[b]);
+        record_result(&ctx->results, "branch", params, "cycles", samples, RESULT_SAMPLES);
+
+        cachebench_printf(ctx, "random %d%%\t%.2f\t%.2f", biases[b], point.cycles, point.cycles - always);
+        print_miss_rate(ctx, point.miss_rate);
+
+        // A fair coin is mispredicted half the time, or as often as counted
+        if (biases[b] == 50) {
+            double rate = point.miss_rate > 0 ? point.miss_rate : 0.5;
+            mispredict = (point.cycles - always) / rate;
+        }
+    }
+    cachebench_printf(ctx, "Mispredict cost: %.1f cycles\n\n", mispredict);
+    return mispredict;
+}
+
+// N distinct branches, each with its own short pattern, against the same
+// code always taken. The extra cost rises once the predictor runs out of
+// entries for the patterns.
+static void run_capacity_sweep(cachebench_context_t* ctx, unsigned char* code, size_t region,
+                               uint8_t* outcomes, int miss_fd, double mispredict) {
+    const char* miss_header = miss_fd >= 0 ? "\tMispredicts" : "";
+    cachebench_printf(ctx, "N static branches, period-%d pattern each (cycles/branch)\n",
+                      BRANCH_CAPACITY_PERIOD);
+    cachebench_printf(ctx, "Branches\tTaken\tPattern\tExtra%s\n", miss_header);
+    cachebench_printf(ctx, "----------------------------------------------------\n");
+
+    int cliff = 0;
+    for (int n = 1; n <= BRANCH_MAX_STATIC; n *= 2) {
+        if (generate_branches(code, region, n) != 0) return;
+        branch_fn_t fn = (branch_fn_t)(void*)code;
+        double samples[RESULT_SAMPLES];
+
+        memset(outcomes, 1, n);
+        branch_point_t taken = time_branches(fn, outcomes, n, 1, -1, samples);
+        char params[64];
+        snprintf(params, sizeof(params), "kind=capacity,branches=%d,period=1", n);
+        record_result(&ctx->results, "branch", params, "cycles", samples, RESULT_SAMPLES);
+
+        fill_outcomes(outcomes, n, BRANCH_CAPACITY_PERIOD, 50);
+        branch_point_t pattern = time_branches(fn, outcomes, n, BRANCH_CAPACITY_PERIOD, miss_fd, samples);
+        snprintf(params, sizeof(params), "kind=capacity,branches=%d,period=%d", n, BRANCH_CAPACITY_PERIOD);
+        record_result(&ctx->results, "branch", params, "cycles", samples, RESULT_SAMPLES);
+
+        double extra = pattern.cycles - taken.cycles;
+        // A cliff once one branch in eight mispredicts
+        if (!cliff && mispredict > 0 && extra > mispredict / 8) cliff = n;
+
+        cachebench_printf(ctx, "%d\t\t%.2f\t%.2f\t%.2f", n, taken.cycles, pattern.cycles, extra);
+        print_miss_rate(ctx, pattern.miss_rate);
+    }
+    if (cliff) cachebench_printf(ctx, "Predictor capacity cliff: %d branches\n\n", cliff);
+    else cachebench_printf(ctx, "No capacity cliff up to %d branches\n\n", BRANCH_MAX_STATIC);
+}
+
+// Indirect call targets: distinct functions the compiler cannot merge
+#define DEFINE_TARGET(K) \
+    __attribute__((noinline)) static uint64_t target_##K(uint64_t x) { return x * 3 + K; }
+#define EACH_8(X, B) X(B##0) X(B##1) X(B##2) X(B##3) X(B##4) X(B##5) X(B##6) X(B##7)
+#define EACH_TARGET(X) EACH_8(X, 1) EACH_8(X, 2) EACH_8(X, 3) EACH_8(X, 4) \
+                       EACH_8(X, 5) EACH_8(X, 6) EACH_8(X, 7) EACH_8(X, 8)
+
+EACH_TARGET(DEFINE_TARGET)
+
+#define TARGET_ENTRY(K) target_##K,
+static uint64_t (*const indirect_targets[BRANCH_MAX_TARGETS])(uint64_t) = {EACH_TARGET(TARGET_ENTRY)};
+
+static volatile uint64_t branch_sink;
+
+static double time_indirect(const uint8_t* selectors, int miss_fd, double* miss_rate, double* samples) {
+    uint64_t x = 0;
+    for (int s = -1; s < RESULT_SAMPLES; s++) {
+        if (s == 0) counter_start(miss_fd);
+        uint64_t start = get_cycles();
+        for (int rep = 0; rep < BRANCH_EXECUTIONS / BRANCH_SELECTORS; rep++) {
+            for (int i = 0; i < BRANCH_SELECTORS; i++) x = indirect_targets[selectors[i]](x);
+        }
+        double cycles = (double)(get_cycles() - start) / BRANCH_EXECUTIONS;
+        if (s >= 0) samples[s] = cycles;
+    }
+    uint64_t misses = counter_stop(miss_fd);
+    branch_sink = x;
+    *miss_rate = miss_fd >= 0 ? (double)misses / ((double)BRANCH_EXECUTIONS * RESULT_SAMPLES) : -1;
+    return median_of_samples(samples, RESULT_SAMPLES);
+}
+
+static void run_indirect_sweep(cachebench_context_t* ctx, uint8_t* selectors, int miss_fd) {
+    cachebench_printf(ctx, "Indirect calls through one call site (cycles/call)\n");
+    cachebench_printf(ctx, "Targets\tCyclic\tRandom\tExtra (random)%s\n",
+                      miss_fd >= 0 ? "\tMispredicts (random)" : "");
+    cachebench_printf(ctx, "----------------------------------------------------\n");
+
+    double single = 0;
+    for (int targets = 1; targets <= BRANCH_MAX_TARGETS; targets *= 2) {
+        double cost[2], miss_rate = -1;
+        for (int random = 0; random < 2; random++) {
+            for (int i = 0; i < BRANCH_SELECTORS; i++) {
+                selectors[i] = (uint8_t)(random ? rand() % targets : i % targets);
+            }
+            double samples[RESULT_SAMPLES];
+            cost[random] = time_indirect(selectors, miss_fd, &miss_rate, samples);
+
+            char params[64];
+            snprintf(params, sizeof(params), "kind=indirect,targets=%d,order=%s",
+                     targets, random ? "random" : "cyclic");
+            record_result(&ctx->results, "branch", params, "cycles", samples, RESULT_SAMPLES);
+        }
+        if (targets == 1) single = cost[1];
+
+        cachebench_printf(ctx, "%d\t%.2f\t%.2f\t%.2f", targets, cost[0], cost[1], cost[1] - single);
+        if (miss_fd >= 0) cachebench_printf(ctx, "\t\t");
+        print_miss_rate(ctx, miss_rate);
+    }
+    cachebench_printf(ctx, "\n");
+}
+
+static void run_branch_test(cachebench_context_t* ctx) {
+#if defined(_WIN32) || !defined(__x86_64__)
+    cachebench_printf(ctx, "Branch test generates x86-64 SysV code; not supported on this platform\n\n");
+#else
+    size_t region = (size_t)BRANCH_MAX_STATIC * BRANCH_BLOCK + 4096;
+    unsigned char* code = mmap(NULL, region, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    uint8_t* outcomes = malloc(BRANCH_OUTCOME_BYTES);
+    if (code == MAP_FAILED || !outcomes) {
+        cachebench_printf(ctx, "Failed to allocate memory for branch test\n");
+        if (code != MAP_FAILED) munmap(code, region);
+        free(outcomes);
+        return;
+    }
+    int miss_fd = counter_open(COUNTER_BRANCH_MISSES);
+
+    cachebench_printf(ctx, "=== Branch Prediction ===\n");
+    cachebench_printf(ctx, "Generated conditional branches, %d per sample; TSC cycles, extra over "
+                      "always-taken\n", BRANCH_EXECUTIONS);
+    if (miss_fd < 0) {
+        cachebench_printf(ctx, "Branch-miss counter unavailable (perf_event_open failed); "
+                          "mispredict cost assumes a fair coin misses half the time\n");
+    }
+    cachebench_printf(ctx, "\n");
+
+    double mispredict = run_pattern_sweep(ctx, code, region, outcomes, miss_fd);
+    if (mispredict < 0) {
+        cachebench_printf(ctx, "Cannot generate executable code (W^X policy?)\n\n");
+    } else {
+        run_capacity_sweep(ctx, code, region, outcomes, miss_fd, mispredict);
+    }
+    run_indirect_sweep(ctx, outcomes, miss_fd);
+
+    counter_close(miss_fd);
+    free(outcomes);
+    munmap(code, region);
+#endif
+}
+
+const cachebench_test_t branch_test = {
+    "branch", "Branch pattern periods, predictor capacity and indirect call targets",
+    "kind=pattern|random|capacity|indirect,period=1..8192,branches=1..64K,targets=1..64", "cycles",
+    0, run_branch_test
+};
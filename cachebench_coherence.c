@@ -0,0 +1,324 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <immintrin.h>
+
+#define COHERENCE_LINES 256            // Lines per round, a dependent chain in random order
+#define COHERENCE_ROUNDS 16            // Rounds per sample, each set up from flushed lines
+#define COHERENCE_MAX_READERS 8        // Largest sharer count for the write test
+#define COHERENCE_DATA_OFFSET 8        // Helpers write here; the chain pointer stays at 0
+
+// State the measuring thread finds the lines in
+typedef enum {
+    LINE_LOCAL,                        // In its own L1: read by itself
+    LINE_FLUSHED,                      // Nowhere in the caches
+    LINE_MODIFIED,                     // Written by one helper
+    LINE_EXCLUSIVE,                    // Read by one helper only
+    LINE_SHARED,                       // Read by two helpers
+    NUM_LINE_STATES
+} line_state_t;
+
+static const char* line_state_names[NUM_LINE_STATES] = {
+    "local", "flushed", "modified", "exclusive", "shared"
+};
+
+typedef enum {
+    HELPER_IDLE,
+    HELPER_READ,
+    HELPER_WRITE,
+    HELPER_QUIT
+} helper_op_t;
+
+typedef struct {
+    char* lines;
+    const size_t* order;
+    const int* cpus;                   // cpus[0] measures, the rest are helpers
+    int helpers;
+
+    // A command is op for helpers [0, active), published by bumping generation;
+    // every helper acknowledges every command
+    helper_op_t op;
+    int active;
+    _Alignas(CACHE_LINE_SIZE) _Atomic unsigned generation;
+    _Alignas(CACHE_LINE_SIZE) _Atomic int acks;
+
+    // Measurements: loads per state when helpers allow it, then one locked
+    // RMW pass with every helper reading
+    int measure_loads;
+    double load_samples[NUM_LINE_STATES][RESULT_SAMPLES];
+    double write_samples[RESULT_SAMPLES];
+} coherence_run_t;
+
+typedef struct {
+    coherence_run_t* run;
+    int index;
+} helper_arg_t;
+
+static volatile uint64_t coherence_sink;
+
+static void wait_acks(coherence_run_t* run) {
+    int spins = 0;
+    while (atomic_load_explicit(&run->acks, memory_order_acquire) < run->helpers) spin_wait(&spins);
+}
+
+// Run op on the first active helpers and wait until all have finished
+static void command_helpers(coherence_run_t* run, helper_op_t op, int active) {
+    run->op = op;
+    run->active = active;
+    atomic_store_explicit(&run->acks, 0, memory_order_relaxed);
+    atomic_fetch_add_explicit(&run->generation, 1, memory_order_release);
+    if (op != HELPER_QUIT) wait_acks(run);
+}
+
+static void* helper_thread(void* arg) {
+    helper_arg_t* h = arg;
+    coherence_run_t* run = h->run;
+    pin_thread(run->cpus[h->index + 1]);
+
+    unsigned seen = 0;
+    atomic_fetch_add_explicit(&run->acks, 1, memory_order_release);
+    for (;;) {
+        int spins = 0;
+        unsigned generation;
+        while ((generation = atomic_load_explicit(&run->generation, memory_order_acquire)) == seen) {
+            spin_wait(&spins);
+        }
+        seen = generation;
+        if (run->op == HELPER_QUIT) return NULL;
+
+        if (h->index < run->active) {
+            uint64_t sum = 0;
+            for (size_t i = 0; i < COHERENCE_LINES; i++) {
+                volatile uint64_t* word = (volatile uint64_t*)(run->lines + i * CACHE_LINE_SIZE +
+                                                               COHERENCE_DATA_OFFSET);
+                if (run->op == HELPER_WRITE) *word = i;
+                else sum += *word;
+            }
+            coherence_sink = sum;
+        }
+        atomic_fetch_add_explicit(&run->acks, 1, memory_order_release);
+    }
+}
+
+static void flush_lines(char* lines) {
+    for (size_t i = 0; i < COHERENCE_LINES; i++) _mm_clflush(lines + i * CACHE_LINE_SIZE);
+    _mm_mfence();
+}
+
+// Dependent loads through every line; TSC cycles
+static uint64_t time_chase(coherence_run_t* run) {
+    void* p = run->lines + run->order[0] * CACHE_LINE_SIZE;
+    _mm_mfence();
+    uint64_t start = get_cycles();
+    for (size_t i = 0; i < COHERENCE_LINES; i++) p = *(void**)p;
+    uint64_t cycles = get_cycles() - start;
+    coherence_sink = (uintptr_t)p;
+    return cycles;
+}
+
+// A locked add to every line; each waits for its ownership request
+static uint64_t time_rmw(coherence_run_t* run) {
+    _mm_mfence();
+    uint64_t start = get_cycles();
+    for (size_t i = 0; i < COHERENCE_LINES; i++) {
+        _Atomic uint64_t* word = (_Atomic uint64_t*)(run->lines + run->order[i] * CACHE_LINE_SIZE +
+                                                     COHERENCE_DATA_OFFSET);
+        atomic_fetch_add_explicit(word, 1, memory_order_relaxed);
+    }
+    return get_cycles() - start;
+}
+
+// Put the lines in state, from flushed
+static void set_up_state(coherence_run_t* run, line_state_t state) {
+    flush_lines(run->lines);
+    switch (state) {
+    case LINE_LOCAL:
+        time_chase(run);
+        break;
+    case LINE_MODIFIED:
+        command_helpers(run, HELPER_WRITE, 1);
+        break;
+    case LINE_EXCLUSIVE:
+        command_helpers(run, HELPER_READ, 1);
+        break;
+    case LINE_SHARED:
+        command_helpers(run, HELPER_READ, 2);
+        break;
+    default:
+        break;
+    }
+}
+
+static void* measure_thread(void* arg) {
+    coherence_run_t* run = arg;
+    pin_thread(run->cpus[0]);
+    wait_acks(run);
+
+    for (int state = 0; state < NUM_LINE_STATES && run->measure_loads; state++) {
+        // Shared needs a second helper
+        if (state == LINE_SHARED && run->helpers < 2) break;
+        for (int s = 0; s < RESULT_SAMPLES; s++) {
+            uint64_t total = 0;
+            for (int r = 0; r < COHERENCE_ROUNDS; r++) {
+                set_up_state(run, state);
+                total += time_chase(run);
+            }
+            run->load_samples[state][s] = (double)total / (COHERENCE_ROUNDS * COHERENCE_LINES);
+        }
+    }
+
+    for (int s = 0; s < RESULT_SAMPLES; s++) {
+        uint64_t total = 0;
+        for (int r = 0; r < COHERENCE_ROUNDS; r++) {
+            flush_lines(run->lines);
+            command_helpers(run, HELPER_READ, run->helpers);
+            total += time_rmw(run);
+        }
+        run->write_samples[s] = (double)total / (COHERENCE_ROUNDS * COHERENCE_LINES);
+    }
+
+    command_helpers(run, HELPER_QUIT, 0);
+    return NULL;
+}
+
+// One measuring thread and threads - 1 helpers on cpus. Returns -1 when a
+// thread could not be started.
+static int run_coherence(coherence_run_t* run, const int* cpus, int threads, int measure_loads) {
+    pthread_t handles[COHERENCE_MAX_READERS + 1];
+    helper_arg_t args[COHERENCE_MAX_READERS];
+    run->cpus = cpus;
+    run->helpers = threads - 1;
+    run->measure_loads = measure_loads;
+    run->op = HELPER_IDLE;
+    atomic_store(&run->generation, 0);
+    atomic_store(&run->acks, 0);
+
+    int created = 0;
+    for (; created < run->helpers; created++) {
+        args[created] = (helper_arg_t){run, created};
+        if (pthread_create(&handles[created + 1], NULL, helper_thread, &args[created]) != 0) break;
+    }
+    int ok = created == run->helpers &&
+             pthread_create(&handles[0], NULL, measure_thread, run) == 0;
+    if (ok) {
+        pthread_join(handles[0], NULL);
+    } else {
+        // Started helpers are waiting for a command; release them
+        run->op = HELPER_QUIT;
+        atomic_fetch_add_explicit(&run->generation, 1, memory_order_release);
+    }
+    for (int t = 0; t < created; t++) pthread_join(handles[t + 1], NULL);
+    return ok ? 0 : -1;
+}
+
+static void run_coherence_test(cachebench_context_t* ctx) {
+    cpu_topology_t topo;
+    get_cpu_topology(&topo);
+    int max_threads = worker_threads(ctx);
+    if (max_threads > COHERENCE_MAX_READERS + 1) max_threads = COHERENCE_MAX_READERS + 1;
+
+    char* lines = aligned_alloc(4096, COHERENCE_LINES * CACHE_LINE_SIZE);
+    size_t* order = malloc(COHERENCE_LINES * sizeof(size_t));
+    coherence_run_t* run = aligned_alloc(CACHE_LINE_SIZE, sizeof(coherence_run_t));
+    if (!lines || !order || !run) {
+        cachebench_printf(ctx, "Failed to allocate memory for coherence test\n");
+        goto done;
+    }
+
+    // One random cycle through the lines, so prefetchers cannot follow it
+    for (size_t i = 0; i < COHERENCE_LINES; i++) order[i] = i;
+    for (size_t i = COHERENCE_LINES - 1; i > 0; i--) {
+        size_t j = (size_t)rand() % (i + 1);
+        size_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    memset(lines, 0, COHERENCE_LINES * CACHE_LINE_SIZE);
+    for (size_t i = 0; i < COHERENCE_LINES; i++) {
+        *(void**)(lines + order[i] * CACHE_LINE_SIZE) =
+            lines + order[(i + 1) % COHERENCE_LINES] * CACHE_LINE_SIZE;
+    }
+    memset(run, 0, sizeof(*run));
+    run->lines = lines;
+    run->order = order;
+
+    cachebench_printf(ctx, "=== Cache Coherence Transitions ===\n");
+    cachebench_printf(ctx, "TSC cycles per line, %d lines x %d rounds per sample, each round from "
+                      "flushed lines; placements the machine lacks are skipped\n",
+                      COHERENCE_LINES, COHERENCE_ROUNDS);
+    if (max_threads < 2) {
+        cachebench_printf(ctx, "Needs at least two threads (--threads)\n\n");
+        goto done;
+    }
+
+    // Loads from lines a helper holds in each state
+    cachebench_printf(ctx, "\nDependent loads by the measuring thread\n");
+    cachebench_printf(ctx, "Placement\tLocal\tFlushed\tM\tE\tS\n");
+    cachebench_printf(ctx, "------------------------------------------------------------\n");
+    int cpus[MAX_CPUS];
+    for (int placement = 0; placement < NUM_PLACEMENTS; placement++) {
+        int threads = max_threads >= 3 ? 3 : 2;
+        if (place_threads(&topo, placement, threads, cpus) != 0) {
+            threads = 2;
+            if (place_threads(&topo, placement, threads, cpus) != 0) continue;
+        }
+        if (run_coherence(run, cpus, threads, 1) != 0) continue;
+
+        cachebench_printf(ctx, "%-12s", placement_names[placement]);
+        for (int state = 0; state < NUM_LINE_STATES; state++) {
+            if (state == LINE_SHARED && threads < 3) {
+                cachebench_printf(ctx, "\tn/a");
+                continue;
+            }
+            const double* samples = run->load_samples[state];
+            cachebench_printf(ctx, "\t%.1f", median_of_samples(samples, RESULT_SAMPLES));
+
+            char params[64];
+            snprintf(params, sizeof(params), "op=load,state=%s,placement=%s",
+                     line_state_names[state], placement_names[placement]);
+            record_result(&ctx->results, "coherence", params, "cycles", samples, RESULT_SAMPLES);
+        }
+        cachebench_printf(ctx, "\n");
+    }
+
+    // Invalidating K sharers
+    cachebench_printf(ctx, "\nLocked RMW by the measuring thread on lines K helpers have read\n");
+    cachebench_printf(ctx, "Placement");
+    for (int readers = 1; readers < max_threads; readers *= 2) cachebench_printf(ctx, "\tK=%d", readers);
+    cachebench_printf(ctx, "\n");
+    cachebench_printf(ctx, "------------------------------------------------------------\n");
+    for (int placement = 0; placement < NUM_PLACEMENTS; placement++) {
+        if (place_threads(&topo, placement, 2, cpus) != 0) continue;
+        cachebench_printf(ctx, "%-12s", placement_names[placement]);
+        for (int readers = 1; readers < max_threads; readers *= 2) {
+            if (place_threads(&topo, placement, readers + 1, cpus) != 0 ||
+                run_coherence(run, cpus, readers + 1, 0) != 0) {
+                cachebench_printf(ctx, "\tn/a");
+                continue;
+            }
+            cachebench_printf(ctx, "\t%.1f", median_of_samples(run->write_samples, RESULT_SAMPLES));
+
+            char params[64];
+            snprintf(params, sizeof(params), "op=rmw,readers=%d,placement=%s",
+                     readers, placement_names[placement]);
+            record_result(&ctx->results, "coherence", params, "cycles", run->write_samples,
+                          RESULT_SAMPLES);
+        }
+        cachebench_printf(ctx, "\n");
+    }
+    cachebench_printf(ctx, "\n");
+
+done:
+    free(run);
+    free(order);
+    free(lines);
+}
+
+const cachebench_test_t coherence_test = {
+    "coherence", "Loads of lines held M/E/S by another core and RMWs invalidating K sharers",
+    "op=load|rmw,state=local|flushed|modified|exclusive|shared,readers=1..8,placement", "cycles",
+    0, run_coherence_test
+};
@@ -0,0 +1,334 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#define CONTENTION_RUN_MS 10           // Length of one timed sample
+#define CONTENTION_CHUNK 64            // Operations between checks of the stop flag
+
+typedef enum {
+    PRIM_LOAD,
+    PRIM_STORE,
+    PRIM_FETCH_ADD,
+    PRIM_CAS,                          // Compare-and-swap increment loop
+    PRIM_XCHG,
+    PRIM_MUTEX,                        // pthread_mutex around an increment
+    PRIM_TAS,                          // Test-and-test-and-set spinlock
+    PRIM_TICKET,
+    PRIM_MCS,                          // Queue lock, each waiter spins on its own line
+    PRIM_SEQLOCK,                      // Thread 0 writes, the others read
+    NUM_PRIMITIVES
+} primitive_t;
+
+static const char* primitive_names[NUM_PRIMITIVES] = {
+    "load", "store", "fetch_add", "cas", "xchg", "mutex", "tas", "ticket", "mcs", "seqlock"
+};
+
+typedef struct mcs_node {
+    _Alignas(CACHE_LINE_SIZE) _Atomic(struct mcs_node*) next;
+    _Atomic int locked;
+} mcs_node_t;
+
+// Every contended object on its own line, so only the intended sharing occurs
+typedef struct {
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint64_t word;
+    _Alignas(CACHE_LINE_SIZE) uint64_t counter;          // Protected by the lock under test
+    _Alignas(CACHE_LINE_SIZE) _Atomic int tas;
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint32_t ticket_next;
+    _Atomic uint32_t ticket_serving;
+    _Alignas(CACHE_LINE_SIZE) _Atomic(mcs_node_t*) mcs_tail;
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint32_t seq;
+    _Atomic uint64_t seq_data[2];
+    _Alignas(CACHE_LINE_SIZE) pthread_mutex_t mutex;
+    _Alignas(CACHE_LINE_SIZE) _Atomic int go;
+    _Atomic int stop;
+} contention_shared_t;
+
+typedef struct {
+    mcs_node_t node;
+    contention_shared_t* shared;
+    primitive_t primitive;
+    int index;
+    int cpu;
+    uint64_t ops;
+    uint64_t sink;
+} contention_worker_t;
+
+static inline void tas_lock(contention_shared_t* sh) {
+    int spins = 0;
+    while (atomic_exchange_explicit(&sh->tas, 1, memory_order_acquire)) {
+        while (atomic_load_explicit(&sh->tas, memory_order_relaxed)) spin_wait(&spins);
+    }
+}
+
+static inline void tas_unlock(contention_shared_t* sh) {
+    atomic_store_explicit(&sh->tas, 0, memory_order_release);
+}
+
+static inline uint32_t ticket_lock(contention_shared_t* sh) {
+    int spins = 0;
+    uint32_t ticket = atomic_fetch_add_explicit(&sh->ticket_next, 1, memory_order_relaxed);
+    while (atomic_load_explicit(&sh->ticket_serving, memory_order_acquire) != ticket) {
+        spin_wait(&spins);
+    }
+    return ticket;
+}
+
+static inline void ticket_unlock(contention_shared_t* sh, uint32_t ticket) {
+    atomic_store_explicit(&sh->ticket_serving, ticket + 1, memory_order_release);
+}
+
+static inline void mcs_lock(contention_shared_t* sh, mcs_node_t* node) {
+    atomic_store_explicit(&node->next, NULL, memory_order_relaxed);
+    atomic_store_explicit(&node->locked, 1, memory_order_relaxed);
+    mcs_node_t* prev = atomic_exchange_explicit(&sh->mcs_tail, node, memory_order_acq_rel);
+    if (prev) {
+        int spins = 0;
+        atomic_store_explicit(&prev->next, node, memory_order_release);
+        while (atomic_load_explicit(&node->locked, memory_order_acquire)) spin_wait(&spins);
+    }
+}
+
+static inline void mcs_unlock(contention_shared_t* sh, mcs_node_t* node) {
+    mcs_node_t* next = atomic_load_explicit(&node->next, memory_order_acquire);
+    if (!next) {
+        mcs_node_t* expected = node;
+        if (atomic_compare_exchange_strong_explicit(&sh->mcs_tail, &expected, NULL,
+                                                    memory_order_release, memory_order_relaxed)) {
+            return;
+        }
+        // A successor is between its exchange and linking itself in
+        int spins = 0;
+        while (!(next = atomic_load_explicit(&node->next, memory_order_acquire))) spin_wait(&spins);
+    }
+    atomic_store_explicit(&next->locked, 0, memory_order_release);
+}
+
+static inline void seqlock_write(contention_shared_t* sh) {
+    uint32_t seq = atomic_load_explicit(&sh->seq, memory_order_relaxed);
+    atomic_store_explicit(&sh->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    uint64_t value = atomic_load_explicit(&sh->seq_data[0], memory_order_relaxed) + 1;
+    atomic_store_explicit(&sh->seq_data[0], value, memory_order_relaxed);
+    atomic_store_explicit(&sh->seq_data[1], value, memory_order_relaxed);
+    atomic_store_explicit(&sh->seq, seq + 2, memory_order_release);
+}
+
+static inline uint64_t seqlock_read(contention_shared_t* sh) {
+    int spins = 0;
+    for (;;) {
+        uint32_t seq = atomic_load_explicit(&sh->seq, memory_order_acquire);
+        if (seq & 1) {
+            spin_wait(&spins);
+            continue;
+        }
+        uint64_t a = atomic_load_explicit(&sh->seq_data[0], memory_order_relaxed);
+        uint64_t b = atomic_load_explicit(&sh->seq_data[1], memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&sh->seq, memory_order_relaxed) == seq) return a + b;
+    }
+}
+
+static inline uint64_t run_primitive(contention_worker_t* w, uint64_t i) {
+    contention_shared_t* sh = w->shared;
+
+    switch (w->primitive) {
+    case PRIM_LOAD:
+        return atomic_load_explicit(&sh->word, memory_order_relaxed);
+    case PRIM_STORE:
+        atomic_store_explicit(&sh->word, i, memory_order_relaxed);
+        return 0;
+    case PRIM_FETCH_ADD:
+        return atomic_fetch_add(&sh->word, 1);
+    case PRIM_CAS: {
+        uint64_t value = atomic_load_explicit(&sh->word, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak(&sh->word, &value, value + 1)) {}
+        return value;
+    }
+    case PRIM_XCHG:
+        return atomic_exchange(&sh->word, i);
+    case PRIM_MUTEX:
+        pthread_mutex_lock(&sh->mutex);
+        sh->counter++;
+        pthread_mutex_unlock(&sh->mutex);
+        return 0;
+    case PRIM_TAS:
+        tas_lock(sh);
+        sh->counter++;
+        tas_unlock(sh);
+        return 0;
+    case PRIM_TICKET: {
+        uint32_t ticket = ticket_lock(sh);
+        sh->counter++;
+        ticket_unlock(sh, ticket);
+        return 0;
+    }
+    case PRIM_MCS:
+        mcs_lock(sh, &w->node);
+        sh->counter++;
+        mcs_unlock(sh, &w->node);
+        return 0;
+    default:
+        if (w->index == 0) {
+            seqlock_write(sh);
+            return 0;
+        }
+        return seqlock_read(sh);
+    }
+}
+
+static void* contention_thread(void* arg) {
+    contention_worker_t* w = arg;
+    pin_thread(w->cpu);
+    while (!atomic_load_explicit(&w->shared->go, memory_order_acquire)) sched_yield();
+
+    uint64_t ops = 0, sink = 0;
+    while (!atomic_load_explicit(&w->shared->stop, memory_order_relaxed)) {
+        for (int i = 0; i < CONTENTION_CHUNK; i++) sink += run_primitive(w, ops + i);
+        ops += CONTENTION_CHUNK;
+    }
+    w->ops = ops;
+    w->sink = sink;
+    return NULL;
+}
+
+static void sleep_ms(int ms) {
+    struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+// ns per operation per thread for one run of CONTENTION_RUN_MS; aggregate
+// Mops/s in *mops. Returns -1 when threads cannot be started.
+static double time_contention(primitive_t primitive, const int* cpus, int threads, double* mops) {
+    contention_shared_t* shared = aligned_alloc(CACHE_LINE_SIZE, sizeof(contention_shared_t));
+    contention_worker_t* workers = aligned_alloc(CACHE_LINE_SIZE, threads * sizeof(contention_worker_t));
+    pthread_t* handles = calloc(threads, sizeof(pthread_t));
+    if (!shared || !workers || !handles) {
+        free(shared);
+        free(workers);
+        free(handles);
+        return -1;
+    }
+    memset(shared, 0, sizeof(*shared));
+    pthread_mutex_init(&shared->mutex, NULL);
+
+    int created = 0;
+    for (int t = 0; t < threads; t++) {
+        memset(&workers[t], 0, sizeof(workers[t]));
+        workers[t].shared = shared;
+        workers[t].primitive = primitive;
+        workers[t].index = t;
+        workers[t].cpu = cpus[t];
+        if (pthread_create(&handles[t], NULL, contention_thread, &workers[t]) != 0) break;
+        created++;
+    }
+
+    double start_time = get_time_ms();
+    atomic_store_explicit(&shared->go, 1, memory_order_release);
+    sleep_ms(CONTENTION_RUN_MS);
+    atomic_store_explicit(&shared->stop, 1, memory_order_relaxed);
+    for (int t = 0; t < created; t++) pthread_join(handles[t], NULL);
+    double ms = get_time_ms() - start_time;
+
+    uint64_t ops = 0;
+    for (int t = 0; t < created; t++) ops += workers[t].ops;
+
+    pthread_mutex_destroy(&shared->mutex);
+    free(shared);
+    free(workers);
+    free(handles);
+
+    if (created < threads || ops == 0) return -1;
+    *mops = ops / (ms * 1e3);
+    return ms * 1e6 * threads / ops;
+}
+
+static void run_contention_row(cachebench_context_t* ctx, placement_t placement, const int* cpus,
+                               int threads) {
+    cachebench_printf(ctx, "%-12s\t%d", placement_names[placement], threads);
+
+    for (int p = 0; p < NUM_PRIMITIVES; p++) {
+        double samples[RESULT_SAMPLES], agg_samples[RESULT_SAMPLES];
+        double ns = 0, mops = 0, sample_mops;
+        int ok = 1;
+        for (int s = 0; s < RESULT_SAMPLES && ok; s++) {
+            samples[s] = time_contention(p, cpus, threads, &sample_mops);
+            ok = samples[s] > 0;
+            // Throughput is stored as ns per operation across all threads,
+            // so like every stored metric it is lower-is-better
+            agg_samples[s] = ok ? 1e3 / sample_mops : 0;
+            ns += samples[s] / RESULT_SAMPLES;
+            mops += sample_mops / RESULT_SAMPLES;
+        }
+        if (!ok) {
+            cachebench_printf(ctx, "\tn/a");
+            continue;
+        }
+
+        char params[64];
+        snprintf(params, sizeof(params), "op=%s,placement=%s,threads=%d",
+                 primitive_names[p], placement_names[placement], threads);
+        record_result(&ctx->results, "contention", params, "ns", samples, RESULT_SAMPLES);
+        record_result(&ctx->results, "contention", params, "agg_ns", agg_samples, RESULT_SAMPLES);
+        cachebench_printf(ctx, "\t%.1f/%.1f", ns, mops);
+    }
+    cachebench_printf(ctx, "\n");
+}
+
+static void run_contention_test(cachebench_context_t* ctx) {
+    cpu_topology_t topo;
+    get_cpu_topology(&topo);
+    int max_threads = worker_threads(ctx);
+    if (max_threads > MAX_CPUS) max_threads = MAX_CPUS;
+
+    int cores = 0, domains = 0, packages = 0;
+    for (int c = 0; c < topo.num_cpus; c++) {
+        int new_core = 1, new_domain = 1, new_package = 1;
+        for (int d = 0; d < c; d++) {
+            if (topo.cpus[d].core == topo.cpus[c].core) new_core = 0;
+            if (topo.cpus[d].llc == topo.cpus[c].llc) new_domain = 0;
+            if (topo.cpus[d].package == topo.cpus[c].package) new_package = 0;
+        }
+        cores += new_core;
+        domains += new_domain;
+        packages += new_package;
+    }
+
+    cachebench_printf(ctx, "=== Atomics and Locks Under Contention ===\n");
+    cachebench_printf(ctx, "%d CPUs, %d cores, %d LLC domains, %d packages; up to %d threads, "
+                      "%d ms per sample\n", topo.num_cpus, cores, domains, packages, max_threads,
+                      CONTENTION_RUN_MS);
+    cachebench_printf(ctx, "ns per operation per thread / aggregate Mops/s, all threads on one "
+                      "shared line (placements the machine lacks are skipped)\n");
+    cachebench_printf(ctx, "Placement\tThreads");
+    for (int p = 0; p < NUM_PRIMITIVES; p++) cachebench_printf(ctx, "\t%s", primitive_names[p]);
+    cachebench_printf(ctx, "\n");
+    cachebench_printf(ctx, "--------------------------------------------------------------------------------------------------------------\n");
+
+    int cpus[MAX_CPUS];
+    for (int placement = 0; placement < NUM_PLACEMENTS; placement++) {
+        // Unpinned from one thread; pinned placements need two to mean anything
+        int first = placement == PLACEMENT_ANY ? 1 : 2;
+        for (int threads = first; threads <= max_threads; threads *= 2) {
+            if (place_threads(&topo, placement, threads, cpus) != 0) break;
+            run_contention_row(ctx, placement, cpus, threads);
+
+            // Finish at exactly max_threads when it is not a power of two
+            if (threads < max_threads && threads * 2 > max_threads &&
+                place_threads(&topo, placement, max_threads, cpus) == 0) {
+                run_contention_row(ctx, placement, cpus, max_threads);
+            }
+        }
+    }
+    cachebench_printf(ctx, "\n");
+}
+
+const cachebench_test_t contention_test = {
+    "contention", "Atomics, mutex, TAS/ticket/MCS spinlocks and seqlock under contention",
+    "op=load..seqlock,placement=any|smt|same-llc|cross-llc|cross-socket,threads=1..N", "ns, agg_ns",
+    0, run_contention_test
+};
@@ -0,0 +1,72 @@
+#include "cachebench.h"
+
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+const char* counter_names[NUM_COUNTERS] = {"cycles", "instructions", "branch-misses",
+                                           "L1I-misses", "iTLB-misses"};
+
+#ifdef __linux__
+static const struct {
+    uint32_t type;
+    uint64_t config;
+} counter_events[NUM_COUNTERS] = {
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1I | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_ITLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+#endif
+
+// A stopped counter for event on the calling thread, or -1 when the kernel,
+// hypervisor or perf_event_paranoid does not allow one
+int counter_open(counter_event_t event) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = counter_events[event].type;
+    attr.config = counter_events[event].config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    long fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    return fd < 0 ? -1 : (int)fd;
+#else
+    (void)event;
+    return -1;
+#endif
+}
+
+// Zero the counter and start counting; no-op for fd -1
+void counter_start(int fd) {
+#ifdef __linux__
+    if (fd < 0) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+}
+
+// Stop counting and return the count since counter_start
+uint64_t counter_stop(int fd) {
+    uint64_t count = 0;
+#ifdef __linux__
+    if (fd < 0) return 0;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) count = 0;
+#endif
+    return count;
+}
+
+void counter_close(int fd) {
+    if (fd >= 0) close(fd);
+}
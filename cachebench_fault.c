@@ -0,0 +1,262 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sys/mman.h>
+#endif
+
+#define FAULT_PAGE 4096
+#define FAULT_HUGE_PAGE (2 * 1024 * 1024)
+#define FAULT_MIN_PAGES 512            // Small sizes repeat until a sample covers this many pages
+#define FAULT_MAX_THREADS 64
+
+typedef enum {
+    FAULT_TOUCH,                       // mmap, then write one byte per page
+    FAULT_POPULATE,                    // mmap with MAP_POPULATE, then touch
+    FAULT_WILLNEED,                    // madvise(MADV_WILLNEED), then touch
+    FAULT_POPULATE_WRITE,              // madvise(MADV_POPULATE_WRITE), then touch
+    FAULT_THP,                         // 2MB-aligned, madvise(MADV_HUGEPAGE), then touch
+    FAULT_PARALLEL,                    // mmap, then worker threads touch one slice each
+    FAULT_DONTNEED,                    // madvise(MADV_DONTNEED) of touched pages
+    FAULT_REFAULT,                     // Touch again after MADV_DONTNEED
+    FAULT_RESIDENT,                    // Touch pages already faulted in
+    NUM_FAULT_METHODS
+} fault_method_t;
+
+static const char* fault_names[NUM_FAULT_METHODS] = {
+    "touch", "populate", "willneed", "populate-write", "thp", "parallel", "dontneed", "refault",
+    "resident"
+};
+
+// Table headings, short enough for one tab stop
+static const char* fault_columns[NUM_FAULT_METHODS] = {
+    "touch", "popul", "willnd", "pop-wr", "thp", "par", "dontnd", "refault", "resid"
+};
+
+#ifndef _WIN32
+
+static void touch_pages(char* base, size_t size) {
+    volatile char* p = base;
+    for (size_t offset = 0; offset < size; offset += FAULT_PAGE) p[offset] = 1;
+}
+
+typedef struct {
+    char* base;
+    size_t size;
+} touch_slice_t;
+
+static void* touch_thread(void* arg) {
+    touch_slice_t* slice = arg;
+    touch_pages(slice->base, slice->size);
+    return NULL;
+}
+
+// Touch size bytes from threads workers, one page-aligned slice each. The
+// calling thread takes the first slice, and any whose thread fails to start.
+static void touch_parallel(char* base, size_t size, int threads) {
+    pthread_t handles[FAULT_MAX_THREADS];
+    touch_slice_t slices[FAULT_MAX_THREADS];
+    int started[FAULT_MAX_THREADS] = {0};
+    size_t pages = size / FAULT_PAGE;
+
+    for (int t = 0; t < threads; t++) {
+        size_t first = pages * t / threads, last = pages * (t + 1) / threads;
+        slices[t] = (touch_slice_t){base + first * FAULT_PAGE, (last - first) * FAULT_PAGE};
+        if (t > 0) started[t] = pthread_create(&handles[t], NULL, touch_thread, &slices[t]) == 0;
+    }
+    for (int t = 0; t < threads; t++) {
+        if (!started[t]) touch_pages(slices[t].base, slices[t].size);
+    }
+    for (int t = 1; t < threads; t++) {
+        if (started[t]) pthread_join(handles[t], NULL);
+    }
+}
+
+static char* map_anonymous(size_t size, int flags) {
+    char* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | flags, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+// ns to establish size bytes with method, or -1 when this kernel or build
+// does not support it. Setup a method does not measure stays untimed.
+static double fault_once(fault_method_t method, size_t size, int threads) {
+    char* base;
+    size_t mapped = size;
+    double start, ns = -1;
+
+    switch (method) {
+    case FAULT_TOUCH:
+    case FAULT_POPULATE:
+        start = get_time_ms();
+        base = map_anonymous(size, method == FAULT_POPULATE ? MAP_POPULATE : 0);
+        if (!base) return -1;
+        touch_pages(base, size);
+        ns = (get_time_ms() - start) * 1e6;
+        break;
+
+    case FAULT_WILLNEED:
+    case FAULT_POPULATE_WRITE: {
+#ifdef MADV_POPULATE_WRITE
+        int advice = method == FAULT_WILLNEED ? MADV_WILLNEED : MADV_POPULATE_WRITE;
+#else
+        if (method == FAULT_POPULATE_WRITE) return -1;
+        int advice = MADV_WILLNEED;
+#endif
+        start = get_time_ms();
+        base = map_anonymous(size, 0);
+        if (!base) return -1;
+        if (madvise(base, size, advice) == 0) {
+            touch_pages(base, size);
+            ns = (get_time_ms() - start) * 1e6;
+        }
+        break;
+    }
+
+    case FAULT_THP: {
+#ifdef MADV_HUGEPAGE
+        // Map a huge page extra so the buffer can start on a huge page boundary
+        start = get_time_ms();
+        mapped = size + FAULT_HUGE_PAGE;
+        char* raw = map_anonymous(mapped, 0);
+        if (!raw) return -1;
+        base = (char*)(((uintptr_t)raw + FAULT_HUGE_PAGE - 1) & ~(uintptr_t)(FAULT_HUGE_PAGE - 1));
+        if (madvise(base, size, MADV_HUGEPAGE) == 0) {
+            touch_pages(base, size);
+            ns = (get_time_ms() - start) * 1e6;
+        }
+        base = raw;
+#else
+        return -1;
+#endif
+        break;
+    }
+
+    case FAULT_PARALLEL:
+        start = get_time_ms();
+        base = map_anonymous(size, 0);
+        if (!base) return -1;
+        touch_parallel(base, size, threads);
+        ns = (get_time_ms() - start) * 1e6;
+        break;
+
+    default:
+        base = map_anonymous(size, 0);
+        if (!base) return -1;
+        touch_pages(base, size);
+        if (method == FAULT_RESIDENT) {
+            start = get_time_ms();
+            touch_pages(base, size);
+            ns = (get_time_ms() - start) * 1e6;
+            break;
+        }
+        start = get_time_ms();
+        int dropped = madvise(base, size, MADV_DONTNEED) == 0;
+        ns = (get_time_ms() - start) * 1e6;
+        if (dropped && method == FAULT_REFAULT) {
+            start = get_time_ms();
+            touch_pages(base, size);
+            ns = (get_time_ms() - start) * 1e6;
+        }
+        if (!dropped) ns = -1;
+        break;
+    }
+
+    munmap(base, mapped);
+    return ns;
+}
+
+#endif
+
+static void run_fault_test(cachebench_context_t* ctx) {
+#ifdef _WIN32
+    cachebench_printf(ctx, "Page fault test needs mmap and madvise; not supported on this platform\n\n");
+#else
+    int threads = worker_threads(ctx);
+    if (threads > FAULT_MAX_THREADS) threads = FAULT_MAX_THREADS;
+
+    char thp[64] = "unknown";
+    FILE* f = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (f) {
+        if (!fgets(thp, sizeof(thp), f)) strcpy(thp, "unknown");
+        thp[strcspn(thp, "\n")] = '\0';
+        fclose(f);
+    }
+
+    size_t sizes[MAX_SWEEP_POINTS];
+    int num_sizes = generate_sweep(&(sweep_config_t){FAULT_PAGE, MAX_SIZE, 1, 0}, sizes, MAX_SWEEP_POINTS);
+
+    cachebench_printf(ctx, "=== Page Faults and First Touch ===\n");
+    cachebench_printf(ctx, "ns per 4KB page, mmap included up to par; %d threads for par; THP: %s\n",
+                      threads, thp);
+    cachebench_printf(ctx, "popul=MAP_POPULATE willnd=MADV_WILLNEED pop-wr=MADV_POPULATE_WRITE "
+                      "dontnd=MADV_DONTNEED refault=touch after dontnd resid=already faulted\n");
+    cachebench_printf(ctx, "Size");
+    for (int m = 0; m < NUM_FAULT_METHODS; m++) cachebench_printf(ctx, "\t%s", fault_columns[m]);
+    cachebench_printf(ctx, "\n");
+    cachebench_printf(ctx, "------------------------------------------------------------------------------------\n");
+
+    double largest[NUM_FAULT_METHODS];
+    char largest_label[32] = "";
+    for (int i = 0; i < num_sizes; i++) {
+        size_t size = (sizes[i] + FAULT_PAGE - 1) & ~(size_t)(FAULT_PAGE - 1);
+        size_t pages = size / FAULT_PAGE;
+        int reps = (int)((FAULT_MIN_PAGES + pages - 1) / pages);
+
+        char label[32];
+        format_size(size, label, sizeof(label));
+        cachebench_printf(ctx, "%s", label);
+        strcpy(largest_label, label);
+
+        for (int m = 0; m < NUM_FAULT_METHODS; m++) {
+            double samples[RESULT_SAMPLES];
+            int failed = 0;
+            for (int s = 0; s < RESULT_SAMPLES && !failed; s++) {
+                double total = 0;
+                for (int r = 0; r < reps; r++) {
+                    double ns = fault_once(m, size, threads);
+                    if (ns < 0) {
+                        failed = 1;
+                        break;
+                    }
+                    total += ns;
+                }
+                samples[s] = total / ((double)reps * pages);
+            }
+            if (failed) {
+                largest[m] = -1;
+                cachebench_printf(ctx, "\tn/a");
+                continue;
+            }
+            largest[m] = median_of_samples(samples, RESULT_SAMPLES);
+            cachebench_printf(ctx, "\t%.0f", largest[m]);
+
+            char params[64];
+            snprintf(params, sizeof(params), "method=%s,size=%zu", fault_names[m], size);
+            record_result(&ctx->results, "fault", params, "ns", samples, RESULT_SAMPLES);
+        }
+        cachebench_printf(ctx, "\n");
+    }
+
+    // Summarize at the largest size: what first touch costs a growing arena
+    // and which prefault, if any, is cheapest
+    double extra = largest[FAULT_TOUCH] - largest[FAULT_RESIDENT];
+    cachebench_printf(ctx, "\nFirst touch: %.0f ns/page over a resident touch, %.0f ms per GB of growth\n",
+                      extra, extra * (1024.0 * 1024 * 1024 / FAULT_PAGE) / 1e6);
+    int best = FAULT_TOUCH;
+    for (int m = FAULT_POPULATE; m <= FAULT_PARALLEL; m++) {
+        if (largest[m] > 0 && largest[m] < largest[best]) best = m;
+    }
+    cachebench_printf(ctx, "Cheapest way to fault in %s: %s (%.0f ns/page)\n\n",
+                      largest_label, fault_names[best], largest[best]);
+#endif
+}
+
+const cachebench_test_t fault_test = {
+    "fault", "Page fault and prefault cost: touch, MAP_POPULATE, madvise, THP, threads, DONTNEED",
+    "method=touch|populate|willneed|populate-write|thp|parallel|dontneed|refault|resident,"
+    "size=4K..MAX_SIZE", "ns",
+    0, run_fault_test
+};
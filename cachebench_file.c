@@ -0,0 +1,260 @@
+#define _GNU_SOURCE
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+#define FILE_PAGE 4096
+#define FILE_MAX_BLOCK (1024 * 1024)
+#define FILE_RANDOM_OPS 512            // Random reads per sample
+
+#ifndef _WIN32
+
+// Create and fill a temporary file of ctx->file.size bytes under
+// --file-dir, $TMPDIR or /var/tmp, flushed to disk so its pages can be
+// evicted. Returns the open descriptor; the caller closes and unlinks path.
+int create_bench_file(cachebench_context_t* ctx, char* path, size_t path_len) {
+    const char* dir = ctx->file.dir;
+    if (!dir) dir = getenv("TMPDIR");
+    if (!dir) dir = "/var/tmp";
+    snprintf(path, path_len, "%s/cachebench-XXXXXX", dir);
+
+    int fd = mkstemp(path);
+    if (fd < 0) return -1;
+
+    char* chunk = malloc(FILE_MAX_BLOCK);
+    int failed = !chunk;
+    for (size_t done = 0; !failed && done < ctx->file.size; done += FILE_MAX_BLOCK) {
+        size_t len = ctx->file.size - done < FILE_MAX_BLOCK ? ctx->file.size - done : FILE_MAX_BLOCK;
+        // Distinct bytes per chunk so no filesystem can dedupe or skip it
+        memset(chunk, (int)(done / FILE_MAX_BLOCK) | 1, len);
+        failed = write(fd, chunk, len) != (ssize_t)len;
+    }
+    free(chunk);
+
+    if (failed || fsync(fd) != 0) {
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    return fd;
+}
+
+// Drop the file's pages from the page cache. Returns -1 when the kernel
+// refuses; tmpfs accepts the advice and keeps every page.
+int evict_file(int fd, size_t size) {
+    if (fdatasync(fd) != 0) return -1;
+    return posix_fadvise(fd, 0, (off_t)size, POSIX_FADV_DONTNEED) == 0 ? 0 : -1;
+}
+
+// Fraction of the file's pages in the page cache
+static double resident_fraction(int fd, size_t size) {
+    void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) return -1;
+    size_t pages = (size + FILE_PAGE - 1) / FILE_PAGE;
+    unsigned char* vec = malloc(pages);
+    size_t resident = 0;
+    if (vec && mincore(map, size, vec) == 0) {
+        for (size_t i = 0; i < pages; i++) resident += vec[i] & 1;
+    }
+    free(vec);
+    munmap(map, size);
+    return (double)resident / pages;
+}
+
+typedef enum {
+    ACCESS_READ,                       // read() from the start, block bytes per call
+    ACCESS_PREAD,                      // pread() at block-aligned offsets
+    ACCESS_MMAP,                       // Map the file, load every line of each page
+    ACCESS_DIRECT,                     // pread() through an O_DIRECT descriptor
+} file_access_t;
+
+typedef struct {
+    const char* name;
+    file_access_t access;
+    int random;                        // Random block order instead of sequential
+    int advice;                        // madvise for mapped methods, -1 for none
+    size_t block;                      // Bytes per call, or per page for mmap
+} file_method_t;
+
+static const file_method_t file_methods[] = {
+    {"read", ACCESS_READ, 0, -1, 4096},
+    {"read", ACCESS_READ, 0, -1, 64 * 1024},
+    {"read", ACCESS_READ, 0, -1, 1024 * 1024},
+    {"pread", ACCESS_PREAD, 0, -1, 64 * 1024},
+    {"pread", ACCESS_PREAD, 1, -1, 4096},
+    {"pread", ACCESS_PREAD, 1, -1, 16 * 1024},
+    {"pread", ACCESS_PREAD, 1, -1, 64 * 1024},
+    {"pread", ACCESS_PREAD, 1, -1, 256 * 1024},
+    {"pread", ACCESS_PREAD, 1, -1, 1024 * 1024},
+    {"mmap", ACCESS_MMAP, 0, -1, FILE_PAGE},
+    {"mmap+seq", ACCESS_MMAP, 0, MADV_SEQUENTIAL, FILE_PAGE},
+    {"mmap+willneed", ACCESS_MMAP, 0, MADV_WILLNEED, FILE_PAGE},
+    {"mmap", ACCESS_MMAP, 1, -1, FILE_PAGE},
+    {"mmap+random", ACCESS_MMAP, 1, MADV_RANDOM, FILE_PAGE},
+    {"direct", ACCESS_DIRECT, 0, -1, 1024 * 1024},
+    {"direct", ACCESS_DIRECT, 1, -1, 4096},
+    {"direct", ACCESS_DIRECT, 1, -1, 64 * 1024},
+    {"direct", ACCESS_DIRECT, 1, -1, 1024 * 1024},
+};
+
+#define NUM_FILE_METHODS ((int)(sizeof(file_methods) / sizeof(file_methods[0])))
+
+// Reads the whole file into the page cache before cached rows
+static const file_method_t warm_read = {"read", ACCESS_READ, 0, -1, FILE_MAX_BLOCK};
+
+static volatile uint64_t file_sink;
+
+// Read ops blocks in the given order; returns ns, or -1 on any failure
+static double run_file_method(const file_method_t* m, int fd, int direct_fd, size_t size,
+                              const size_t* order, size_t ops, char* buffer) {
+    double start = get_time_ms();
+
+    switch (m->access) {
+    case ACCESS_READ:
+        if (lseek(fd, 0, SEEK_SET) != 0) return -1;
+        for (size_t i = 0; i < ops; i++) {
+            if (read(fd, buffer, m->block) != (ssize_t)m->block) return -1;
+        }
+        break;
+
+    case ACCESS_PREAD:
+    case ACCESS_DIRECT: {
+        int from = m->access == ACCESS_DIRECT ? direct_fd : fd;
+        for (size_t i = 0; i < ops; i++) {
+            off_t offset = (off_t)(order[i] * m->block);
+            if (pread(from, buffer, m->block, offset) != (ssize_t)m->block) return -1;
+        }
+        break;
+    }
+
+    case ACCESS_MMAP: {
+        const char* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) return -1;
+        if (m->advice >= 0) madvise((void*)map, size, m->advice);
+        uint64_t sum = 0;
+        for (size_t i = 0; i < ops; i++) {
+            const char* page = map + order[i] * FILE_PAGE;
+            for (size_t line = 0; line < FILE_PAGE; line += CACHE_LINE_SIZE) {
+                sum += *(const volatile uint64_t*)(page + line);
+            }
+        }
+        file_sink = sum;
+        double ns = (get_time_ms() - start) * 1e6;
+        munmap((void*)map, size);
+        return ns;
+    }
+    }
+
+    return (get_time_ms() - start) * 1e6;
+}
+
+#endif
+
+static void run_file_test(cachebench_context_t* ctx) {
+#ifdef _WIN32
+    cachebench_printf(ctx, "File test needs POSIX file APIs; not supported on this platform\n\n");
+#else
+    char path[512];
+    int fd = create_bench_file(ctx, path, sizeof(path));
+    if (fd < 0) {
+        cachebench_printf(ctx, "Failed to create a %zu byte file under %s\n", ctx->file.size,
+                          ctx->file.dir ? ctx->file.dir : "$TMPDIR or /var/tmp");
+        return;
+    }
+    size_t size = ctx->file.size & ~(size_t)(FILE_MAX_BLOCK - 1);
+    int direct_fd = open(path, O_RDONLY | O_DIRECT);
+    char* buffer = aligned_alloc(FILE_PAGE, FILE_MAX_BLOCK);
+    size_t* order = malloc(size / FILE_PAGE * sizeof(size_t));
+    if (!buffer || !order) {
+        cachebench_printf(ctx, "Failed to allocate memory for file test\n");
+        goto done;
+    }
+
+    // How much of the file eviction actually drops
+    double left = evict_file(fd, size) == 0 ? resident_fraction(fd, size) : 1.0;
+
+    char label[32];
+    format_size(size, label, sizeof(label));
+    cachebench_printf(ctx, "=== Local File Reads ===\n");
+    cachebench_printf(ctx, "%s file at %s; random methods read %d blocks per sample\n",
+                      label, path, FILE_RANDOM_OPS);
+    cachebench_printf(ctx, "Evicted: POSIX_FADV_DONTNEED before each sample leaves %.0f%% of pages "
+                      "cached%s\n", left * 100, left > 0.5 ? " (tmpfs? evicted rows stay cached)" : "");
+    if (direct_fd < 0) {
+        cachebench_printf(ctx, "O_DIRECT unsupported on this filesystem\n");
+    }
+    cachebench_printf(ctx, "Method\t\tOrder\tBlock\tCached GB/s\tCached us/op\tEvicted GB/s\tEvicted us/op\n");
+    cachebench_printf(ctx, "------------------------------------------------------------------------------------------\n");
+
+    for (int i = 0; i < NUM_FILE_METHODS; i++) {
+        const file_method_t* m = &file_methods[i];
+        size_t blocks = size / m->block;
+        size_t ops = m->random && blocks > FILE_RANDOM_OPS ? FILE_RANDOM_OPS : blocks;
+        for (size_t b = 0; b < blocks; b++) order[b] = b;
+        if (m->random) {
+            for (size_t b = blocks - 1; b > 0; b--) {
+                size_t j = (((size_t)rand() << 31) ^ (size_t)rand()) % (b + 1);
+                size_t tmp = order[b];
+                order[b] = order[j];
+                order[j] = tmp;
+            }
+        }
+
+        char block[32];
+        format_size(m->block, block, sizeof(block));
+        cachebench_printf(ctx, "%-15s\t%s\t%s", m->name, m->random ? "random" : "seq", block);
+
+        for (int evicted = 0; evicted < 2; evicted++) {
+            double samples[RESULT_SAMPLES];
+            int failed = m->access == ACCESS_DIRECT && direct_fd < 0;
+
+            // Cached rows start from a fully cached file
+            if (!evicted && !failed) {
+                failed = run_file_method(&warm_read, fd, direct_fd, size, order,
+                                         size / FILE_MAX_BLOCK, buffer) < 0;
+            }
+            for (int s = 0; s < RESULT_SAMPLES && !failed; s++) {
+                if (evicted) evict_file(fd, size);
+                double ns = run_file_method(m, fd, direct_fd, size, order, ops, buffer);
+                failed = ns < 0;
+                samples[s] = ns / ops;
+            }
+            if (failed) {
+                cachebench_printf(ctx, "\tn/a\t\tn/a%s", evicted ? "" : "\t");
+                continue;
+            }
+
+            double ns = median_of_samples(samples, RESULT_SAMPLES);
+            cachebench_printf(ctx, "\t%.2f\t\t%.2f%s", (double)m->block / ns, ns / 1000,
+                              evicted ? "" : "\t");
+
+            char params[64];
+            snprintf(params, sizeof(params), "method=%s,order=%s,block=%zu,state=%s", m->name,
+                     m->random ? "random" : "seq", m->block, evicted ? "evicted" : "cached");
+            record_result(&ctx->results, "file", params, "ns", samples, RESULT_SAMPLES);
+        }
+        cachebench_printf(ctx, "\n");
+    }
+    cachebench_printf(ctx, "\n");
+
+done:
+    free(order);
+    free(buffer);
+    if (direct_fd >= 0) close(direct_fd);
+    close(fd);
+    unlink(path);
+#endif
+}
+
+const cachebench_test_t file_test = {
+    "file", "Local file reads: read, pread, mmap with madvise and O_DIRECT, cached and evicted",
+    "method=read|pread|mmap*|direct,order=seq|random,block=4K..1M,state=cached|evicted", "ns",
+    0, run_file_test
+};
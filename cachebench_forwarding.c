@@ -0,0 +1,331 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+#define FORWARD_OPS 20000              // Operations per timed sample
+#define FORWARD_MAX_OFFSET 128
+#define FORWARD_PAGE 4096
+#define FORWARD_BUFFER (4 * FORWARD_PAGE)
+#define NUM_WIDTHS 7
+
+static const int widths[NUM_WIDTHS] = {1, 2, 4, 8, 16, 32, 64};
+
+// Widths this build can issue as single instructions
+#ifdef __AVX__
+#define HAVE_WIDTH_32 1
+#else
+#define HAVE_WIDTH_32 0
+#endif
+#ifdef __AVX512F__
+#define HAVE_WIDTH_64 1
+#else
+#define HAVE_WIDTH_64 0
+#endif
+
+static const int width_available[NUM_WIDTHS] = {1, 1, 1, 1, 1, HAVE_WIDTH_32, HAVE_WIDTH_64};
+
+// Offsets printed in the tables; every offset is recorded
+static const int shown_offsets[] = {0, 1, 4, 8, 16, 31, 32, 33, 48, 56, 60, 62, 63, 64, 65, 96, 127};
+
+// Keep every load and store in memory: without it the compiler forwards
+// the value itself or hoists the load out of the loop
+#define compiler_barrier() __asm__ __volatile__("" ::: "memory")
+
+static volatile uint64_t forward_sink;
+
+// One load or store of exactly width bytes, carrying a 64-bit value
+static inline uint64_t load_1(const char* p) { uint8_t v; memcpy(&v, p, 1); return v; }
+static inline uint64_t load_2(const char* p) { uint16_t v; memcpy(&v, p, 2); return v; }
+static inline uint64_t load_4(const char* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint64_t load_8(const char* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+// Vector loads go through asm: only lane 0 is used, and the compiler would
+// otherwise narrow _mm*_loadu to a scalar load of those 8 bytes
+#ifdef __AVX__
+#define VEC_LOAD_16 "vmovdqu %1, %0"
+#else
+#define VEC_LOAD_16 "movdqu %1, %0"
+#endif
+static inline uint64_t load_16(const char* p) {
+    __m128i v;
+    __asm__ __volatile__(VEC_LOAD_16 : "=x"(v) : "m"(*(const __m128i*)p));
+    return (uint64_t)_mm_cvtsi128_si64(v);
+}
+static inline void store_1(char* p, uint64_t x) { uint8_t v = (uint8_t)x; memcpy(p, &v, 1); }
+static inline void store_2(char* p, uint64_t x) { uint16_t v = (uint16_t)x; memcpy(p, &v, 2); }
+static inline void store_4(char* p, uint64_t x) { uint32_t v = (uint32_t)x; memcpy(p, &v, 4); }
+static inline void store_8(char* p, uint64_t x) { memcpy(p, &x, 8); }
+static inline void store_16(char* p, uint64_t x) {
+    _mm_storeu_si128((__m128i*)p, _mm_set1_epi64x((long long)x));
+}
+
+#if HAVE_WIDTH_32
+static inline uint64_t load_32(const char* p) {
+    __m256i v;
+    __asm__ __volatile__("vmovdqu %1, %0" : "=x"(v) : "m"(*(const __m256i*)p));
+    return (uint64_t)_mm_cvtsi128_si64(_mm256_castsi256_si128(v));
+}
+static inline void store_32(char* p, uint64_t x) {
+    _mm256_storeu_si256((__m256i*)p, _mm256_set1_epi64x((long long)x));
+}
+#else
+// Never timed; defined so the kernel tables compile
+static inline uint64_t load_32(const char* p) { return load_16(p); }
+static inline void store_32(char* p, uint64_t x) { store_16(p, x); }
+#endif
+
+#if HAVE_WIDTH_64
+static inline uint64_t load_64(const char* p) {
+    __m512i v;
+    __asm__ __volatile__("vmovdqu64 %1, %0" : "=v"(v) : "m"(*(const __m512i*)p));
+    return (uint64_t)_mm_cvtsi128_si64(_mm512_castsi512_si128(v));
+}
+static inline void store_64(char* p, uint64_t x) {
+    _mm512_storeu_si512((void*)p, _mm512_set1_epi64((long long)x));
+}
+#else
+static inline uint64_t load_64(const char* p) { return load_32(p); }
+static inline void store_64(char* p, uint64_t x) { store_32(p, x); }
+#endif
+
+typedef uint64_t (*load_loop_t)(const char* p, int n);
+typedef void (*store_loop_t)(char* p, int n);
+typedef uint64_t (*forward_loop_t)(char* p, size_t offset, int n);
+
+// Independent loads from one address, four per iteration into separate
+// sums so the adds do not bound throughput; n is a multiple of 4. The
+// barriers stop the compiler merging the four loads into one.
+#define DEFINE_LOAD_LOOP(W) \
+    static uint64_t load_loop_##W(const char* p, int n) { \
+        uint64_t a = 0, b = 0, c = 0, d = 0; \
+        for (int i = 0; i < n; i += 4) { \
+            a += load_##W(p); \
+            compiler_barrier(); \
+            b += load_##W(p); \
+            compiler_barrier(); \
+            c += load_##W(p); \
+            compiler_barrier(); \
+            d += load_##W(p); \
+            compiler_barrier(); \
+        } \
+        return a + b + c + d; \
+    }
+
+#define DEFINE_STORE_LOOP(W) \
+    static void store_loop_##W(char* p, int n) { \
+        for (int i = 0; i < n; i += 4) { \
+            store_##W(p, (uint64_t)i); \
+            compiler_barrier(); \
+            store_##W(p, (uint64_t)i + 1); \
+            compiler_barrier(); \
+            store_##W(p, (uint64_t)i + 2); \
+            compiler_barrier(); \
+            store_##W(p, (uint64_t)i + 3); \
+            compiler_barrier(); \
+        } \
+    }
+
+// Each store's data is the previous load's result, so the loop runs at
+// the store-to-load forwarding latency (or the stall when it fails)
+#define DEFINE_FORWARD_LOOP(WS, WL) \
+    static uint64_t forward_loop_##WS##_##WL(char* p, size_t offset, int n) { \
+        uint64_t x = 0; \
+        for (int i = 0; i < n; i++) { \
+            store_##WS(p, x); \
+            compiler_barrier(); \
+            x = load_##WL(p + offset); \
+        } \
+        return x; \
+    }
+
+#define EACH_WIDTH(X) X(1) X(2) X(4) X(8) X(16) X(32) X(64)
+#define EACH_LOAD_WIDTH(X, WS) X(WS, 1) X(WS, 2) X(WS, 4) X(WS, 8) X(WS, 16) X(WS, 32) X(WS, 64)
+
+EACH_WIDTH(DEFINE_LOAD_LOOP)
+EACH_WIDTH(DEFINE_STORE_LOOP)
+
+#define DEFINE_FORWARD_ROW(WS) EACH_LOAD_WIDTH(DEFINE_FORWARD_LOOP, WS)
+EACH_WIDTH(DEFINE_FORWARD_ROW)
+
+#define LOAD_ENTRY(W) load_loop_##W,
+#define STORE_ENTRY(W) store_loop_##W,
+#define FORWARD_ENTRY(WS, WL) forward_loop_##WS##_##WL,
+#define FORWARD_ROW_ENTRY(WS) {EACH_LOAD_WIDTH(FORWARD_ENTRY, WS)},
+
+static const load_loop_t load_loops[NUM_WIDTHS] = {EACH_WIDTH(LOAD_ENTRY)};
+static const store_loop_t store_loops[NUM_WIDTHS] = {EACH_WIDTH(STORE_ENTRY)};
+static const forward_loop_t forward_loops[NUM_WIDTHS][NUM_WIDTHS] = {EACH_WIDTH(FORWARD_ROW_ENTRY)};
+
+// A store, then an independent load dist bytes away
+static uint64_t alias_loop(char* p, size_t dist, int n) {
+    uint64_t sum = 0;
+    for (int i = 0; i < n; i++) {
+        store_8(p, (uint64_t)i);
+        compiler_barrier();
+        sum += load_8(p + dist);
+    }
+    return sum;
+}
+
+typedef enum {
+    KERNEL_LOAD,
+    KERNEL_STORE,
+    KERNEL_ALIAS,
+    KERNEL_FORWARD
+} forward_kernel_t;
+
+// TSC cycles per operation over RESULT_SAMPLES timed runs after one
+// warm-up. Returns the median: single runs are short enough for one
+// interrupt to dominate them.
+static double time_kernel(forward_kernel_t kernel, int w, int wl, char* p, size_t arg,
+                          double* samples) {
+    for (int s = -1; s < RESULT_SAMPLES; s++) {
+        uint64_t start = get_cycles();
+        switch (kernel) {
+        case KERNEL_LOAD: forward_sink = load_loops[w](p, FORWARD_OPS); break;
+        case KERNEL_STORE: store_loops[w](p, FORWARD_OPS); break;
+        case KERNEL_ALIAS: forward_sink = alias_loop(p, arg, FORWARD_OPS); break;
+        default: forward_sink = forward_loops[w][wl](p, arg, FORWARD_OPS); break;
+        }
+        double cycles = (double)(get_cycles() - start) / FORWARD_OPS;
+        if (s >= 0) samples[s] = cycles;
+    }
+    return median_of_samples(samples, RESULT_SAMPLES);
+}
+
+static int num_shown() {
+    return sizeof(shown_offsets) / sizeof(shown_offsets[0]);
+}
+
+// Loads or stores of every width at offsets 0..FORWARD_MAX_OFFSET-1 from
+// base. The table shows selected offsets, with * where the access splits.
+static void run_access_sweep(cachebench_context_t* ctx, forward_kernel_t kernel, char* base,
+                             const char* split) {
+    double cost[FORWARD_MAX_OFFSET][NUM_WIDTHS];
+    for (int offset = 0; offset < FORWARD_MAX_OFFSET; offset++) {
+        for (int w = 0; w < NUM_WIDTHS; w++) {
+            if (!width_available[w]) continue;
+            double samples[RESULT_SAMPLES];
+            cost[offset][w] = time_kernel(kernel, w, 0, base + offset, 0, samples);
+
+            char params[64];
+            snprintf(params, sizeof(params), "op=%s,split=%s,width=%d,offset=%d",
+                     kernel == KERNEL_LOAD ? "load" : "store", split, widths[w], offset);
+            record_result(&ctx->results, "forwarding", params, "cycles", samples, RESULT_SAMPLES);
+        }
+    }
+
+    cachebench_printf(ctx, "%s, %s split at offset 64 (cycles/op)\n",
+                      kernel == KERNEL_LOAD ? "Loads" : "Stores", split);
+    cachebench_printf(ctx, "Offset");
+    for (int w = 0; w < NUM_WIDTHS; w++) cachebench_printf(ctx, "\t%d B", widths[w]);
+    cachebench_printf(ctx, "\n");
+    for (int i = 0; i < num_shown(); i++) {
+        int offset = shown_offsets[i];
+        cachebench_printf(ctx, "%d", offset);
+        for (int w = 0; w < NUM_WIDTHS; w++) {
+            if (!width_available[w]) {
+                cachebench_printf(ctx, "\tn/a");
+                continue;
+            }
+            int splits = offset % CACHE_LINE_SIZE + widths[w] > CACHE_LINE_SIZE;
+            cachebench_printf(ctx, "\t%.2f%s", cost[offset][w], splits ? "*" : "");
+        }
+        cachebench_printf(ctx, "\n");
+    }
+    cachebench_printf(ctx, "\n");
+}
+
+static void run_alias_sweep(cachebench_context_t* ctx, char* base) {
+    double aliased[FORWARD_MAX_OFFSET], control[FORWARD_MAX_OFFSET];
+    for (int delta = 0; delta < FORWARD_MAX_OFFSET; delta++) {
+        double samples[RESULT_SAMPLES];
+        char params[64];
+
+        aliased[delta] = time_kernel(KERNEL_ALIAS, 0, 0, base, FORWARD_PAGE + delta, samples);
+        snprintf(params, sizeof(params), "op=alias,distance=%d", FORWARD_PAGE + delta);
+        record_result(&ctx->results, "forwarding", params, "cycles", samples, RESULT_SAMPLES);
+
+        control[delta] = time_kernel(KERNEL_ALIAS, 0, 0, base, FORWARD_PAGE / 2 + delta, samples);
+        snprintf(params, sizeof(params), "op=alias,distance=%d", FORWARD_PAGE / 2 + delta);
+        record_result(&ctx->results, "forwarding", params, "cycles", samples, RESULT_SAMPLES);
+    }
+
+    cachebench_printf(ctx, "4K aliasing: 8 B store, then an independent 8 B load (cycles/pair)\n");
+    cachebench_printf(ctx, "Delta\t4096+delta\t2048+delta\n");
+    for (int i = 0; i < num_shown(); i++) {
+        int delta = shown_offsets[i];
+        cachebench_printf(ctx, "%d\t%.2f\t\t%.2f\n", delta, aliased[delta], control[delta]);
+    }
+    cachebench_printf(ctx, "\n");
+}
+
+// Every load width at every offset overlapping a store of each width
+static void run_forward_matrix(cachebench_context_t* ctx, char* base) {
+    cachebench_printf(ctx, "Store-to-load forwarding: load offset from the store start "
+                      "(cycles per store+load, dependent)\n");
+    cachebench_printf(ctx, "Store\tLoad\toff 0\toff 1\tinside\tpartial\tworst (offset)\n");
+
+    for (int ws = 0; ws < NUM_WIDTHS; ws++) {
+        for (int wl = 0; wl < NUM_WIDTHS; wl++) {
+            if (!width_available[ws] || !width_available[wl]) continue;
+
+            double cost[FORWARD_MAX_OFFSET] = {0};
+            int worst = 0;
+            for (int offset = 0; offset < widths[ws]; offset++) {
+                double samples[RESULT_SAMPLES];
+                cost[offset] = time_kernel(KERNEL_FORWARD, ws, wl, base, offset, samples);
+                if (cost[offset] > cost[worst]) worst = offset;
+
+                char params[64];
+                snprintf(params, sizeof(params), "op=forward,store=%d,load=%d,offset=%d",
+                         widths[ws], widths[wl], offset);
+                record_result(&ctx->results, "forwarding", params, "cycles", samples, RESULT_SAMPLES);
+            }
+
+            // Inside: the load ends where the store ends; partial: it starts
+            // halfway and runs past the store
+            int inside = widths[ws] - widths[wl];
+            int partial = widths[ws] / 2;
+            cachebench_printf(ctx, "%d B\t%d B\t%.2f", widths[ws], widths[wl], cost[0]);
+            if (widths[ws] > 1) cachebench_printf(ctx, "\t%.2f", cost[1]);
+            else cachebench_printf(ctx, "\t-");
+            if (inside > 0) cachebench_printf(ctx, "\t%.2f", cost[inside]);
+            else cachebench_printf(ctx, "\t-");
+            if (partial > 0 && partial + widths[wl] > widths[ws]) cachebench_printf(ctx, "\t%.2f", cost[partial]);
+            else cachebench_printf(ctx, "\t-");
+            cachebench_printf(ctx, "\t%.2f (%d)\n", cost[worst], worst);
+        }
+    }
+    cachebench_printf(ctx, "\n");
+}
+
+static void run_forwarding_test(cachebench_context_t* ctx) {
+    char* buffer = arena_buffer(ctx, FORWARD_BUFFER);
+    if (!buffer) return;
+    precondition_buffer(ctx, buffer, FORWARD_BUFFER, PRECONDITION_WARM);
+
+    cachebench_printf(ctx, "=== Split Accesses, 4K Aliasing and Store Forwarding ===\n");
+    cachebench_printf(ctx, "TSC cycles per operation, %d operations per sample, L1-resident "
+                      "buffer; * marks accesses that cross a line\n", FORWARD_OPS);
+    cachebench_printf(ctx, "TSC: %.3f GHz\n\n", measure_tsc_ghz());
+
+    // The second page: offset 64 crosses a line. The end of the second page:
+    // offset 64 crosses into the third page.
+    char* line_base = buffer + FORWARD_PAGE;
+    char* page_base = buffer + 2 * FORWARD_PAGE - CACHE_LINE_SIZE;
+
+    run_access_sweep(ctx, KERNEL_LOAD, line_base, "line");
+    run_access_sweep(ctx, KERNEL_LOAD, page_base, "page");
+    run_access_sweep(ctx, KERNEL_STORE, line_base, "line");
+    run_access_sweep(ctx, KERNEL_STORE, page_base, "page");
+    run_alias_sweep(ctx, line_base);
+    run_forward_matrix(ctx, line_base);
+}
+
+const cachebench_test_t forwarding_test = {
+    "forwarding", "Line- and page-split loads/stores, 4K aliasing and store-to-load forwarding",
+    "op=load|store|alias|forward,width=1..64,offset=0..127", "cycles",
+    0, run_forwarding_test
+};
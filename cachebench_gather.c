@@ -0,0 +1,371 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+#define GATHER_INDICES (256 * 1024)    // Indices per timed sample, a multiple of 16
+#define GATHER_CLUSTER 16              // Clustered: indices sharing one random base
+#define GATHER_CLUSTER_SPAN 64         // Clustered: elements a cluster spreads over
+#define GATHER_DRAM_FACTOR 4           // DRAM table: this many times the last cache level
+
+#ifdef __AVX2__
+#define HAVE_AVX2 1
+#else
+#define HAVE_AVX2 0
+#endif
+#ifdef __AVX512F__
+#define HAVE_AVX512 1
+#else
+#define HAVE_AVX512 0
+#endif
+
+typedef enum {
+    INDEX_SEQUENTIAL,
+    INDEX_CLUSTERED,
+    INDEX_UNIFORM,
+    NUM_DISTRIBUTIONS
+} index_distribution_t;
+
+static const char* distribution_names[NUM_DISTRIBUTIONS] = {"sequential", "clustered", "uniform"};
+
+typedef enum {
+    IMPL_SCALAR,
+    IMPL_AVX2,
+    IMPL_AVX512,
+    NUM_IMPLS
+} gather_impl_t;
+
+static const char* impl_names[NUM_IMPLS] = {"scalar", "avx2", "avx512"};
+
+// Keeps the scalar loops scalar: without it the compiler turns them into
+// the gathers they are compared against
+#define compiler_barrier() __asm__ __volatile__("" ::: "memory")
+
+static volatile uint64_t gather_sink;
+
+// Every kernel handles count indices into table, count a multiple of 16
+typedef uint64_t (*gather_kernel_t)(void* table, const uint32_t* idx, size_t count);
+
+static uint64_t gather32_scalar(void* table, const uint32_t* idx, size_t count) {
+    const uint32_t* t = table;
+    uint64_t a = 0, b = 0, c = 0, d = 0;
+    for (size_t i = 0; i < count; i += 4) {
+        a += t[idx[i]];
+        b += t[idx[i + 1]];
+        c += t[idx[i + 2]];
+        d += t[idx[i + 3]];
+        compiler_barrier();
+    }
+    return a + b + c + d;
+}
+
+static uint64_t gather64_scalar(void* table, const uint32_t* idx, size_t count) {
+    const uint64_t* t = table;
+    uint64_t a = 0, b = 0, c = 0, d = 0;
+    for (size_t i = 0; i < count; i += 4) {
+        a += t[idx[i]];
+        b += t[idx[i + 1]];
+        c += t[idx[i + 2]];
+        d += t[idx[i + 3]];
+        compiler_barrier();
+    }
+    return a + b + c + d;
+}
+
+static uint64_t scatter32_scalar(void* table, const uint32_t* idx, size_t count) {
+    uint32_t* t = table;
+    for (size_t i = 0; i < count; i += 4) {
+        t[idx[i]] = (uint32_t)i;
+        t[idx[i + 1]] = (uint32_t)i + 1;
+        t[idx[i + 2]] = (uint32_t)i + 2;
+        t[idx[i + 3]] = (uint32_t)i + 3;
+        compiler_barrier();
+    }
+    return t[idx[0]];
+}
+
+static uint64_t scatter64_scalar(void* table, const uint32_t* idx, size_t count) {
+    uint64_t* t = table;
+    for (size_t i = 0; i < count; i += 4) {
+        t[idx[i]] = i;
+        t[idx[i + 1]] = i + 1;
+        t[idx[i + 2]] = i + 2;
+        t[idx[i + 3]] = i + 3;
+        compiler_barrier();
+    }
+    return t[idx[0]];
+}
+
+#if HAVE_AVX2
+// vpgatherdd: eight 32-bit elements per instruction
+static uint64_t gather32_avx2(void* table, const uint32_t* idx, size_t count) {
+    __m256i a = _mm256_setzero_si256(), b = a;
+    for (size_t i = 0; i < count; i += 16) {
+        __m256i ia = _mm256_loadu_si256((const __m256i*)(idx + i));
+        __m256i ib = _mm256_loadu_si256((const __m256i*)(idx + i + 8));
+        a = _mm256_add_epi32(a, _mm256_i32gather_epi32((const int*)table, ia, 4));
+        b = _mm256_add_epi32(b, _mm256_i32gather_epi32((const int*)table, ib, 4));
+    }
+    return (uint32_t)_mm256_extract_epi32(_mm256_add_epi32(a, b), 0);
+}
+
+// vpgatherdq: four 64-bit elements per instruction
+static uint64_t gather64_avx2(void* table, const uint32_t* idx, size_t count) {
+    __m256i a = _mm256_setzero_si256(), b = a;
+    for (size_t i = 0; i < count; i += 8) {
+        __m128i ia = _mm_loadu_si128((const __m128i*)(idx + i));
+        __m128i ib = _mm_loadu_si128((const __m128i*)(idx + i + 4));
+        a = _mm256_add_epi64(a, _mm256_i32gather_epi64((const long long*)table, ia, 8));
+        b = _mm256_add_epi64(b, _mm256_i32gather_epi64((const long long*)table, ib, 8));
+    }
+    return (uint64_t)_mm256_extract_epi64(_mm256_add_epi64(a, b), 0);
+}
+#endif
+
+#if HAVE_AVX512
+static uint64_t gather32_avx512(void* table, const uint32_t* idx, size_t count) {
+    __m512i a = _mm512_setzero_si512();
+    for (size_t i = 0; i < count; i += 16) {
+        __m512i ia = _mm512_loadu_si512((const void*)(idx + i));
+        a = _mm512_add_epi32(a, _mm512_i32gather_epi32(ia, table, 4));
+    }
+    return (uint64_t)_mm512_reduce_add_epi32(a);
+}
+
+static uint64_t gather64_avx512(void* table, const uint32_t* idx, size_t count) {
+    __m512i a = _mm512_setzero_si512(), b = a;
+    for (size_t i = 0; i < count; i += 16) {
+        __m256i ia = _mm256_loadu_si256((const __m256i*)(idx + i));
+        __m256i ib = _mm256_loadu_si256((const __m256i*)(idx + i + 8));
+        a = _mm512_add_epi64(a, _mm512_i32gather_epi64(ia, table, 8));
+        b = _mm512_add_epi64(b, _mm512_i32gather_epi64(ib, table, 8));
+    }
+    return (uint64_t)_mm512_reduce_add_epi64(_mm512_add_epi64(a, b));
+}
+
+// Conflicting indices within one vector resolve in lane order, as the
+// scalar loop does
+static uint64_t scatter32_avx512(void* table, const uint32_t* idx, size_t count) {
+    __m512i values = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i step = _mm512_set1_epi32(16);
+    for (size_t i = 0; i < count; i += 16) {
+        __m512i ia = _mm512_loadu_si512((const void*)(idx + i));
+        _mm512_i32scatter_epi32(table, ia, values, 4);
+        values = _mm512_add_epi32(values, step);
+    }
+    return ((uint32_t*)table)[idx[0]];
+}
+
+static uint64_t scatter64_avx512(void* table, const uint32_t* idx, size_t count) {
+    __m512i values = _mm512_setr_epi64(0, 1, 2, 3, 4, 5, 6, 7);
+    __m512i step = _mm512_set1_epi64(8);
+    for (size_t i = 0; i < count; i += 8) {
+        __m256i ia = _mm256_loadu_si256((const __m256i*)(idx + i));
+        _mm512_i32scatter_epi64(table, ia, values, 8);
+        values = _mm512_add_epi64(values, step);
+    }
+    return ((uint64_t*)table)[idx[0]];
+}
+#endif
+
+typedef struct {
+    const char* name;
+    int element;                       // Element size in bytes
+    gather_kernel_t kernels[NUM_IMPLS]; // NULL where the ISA or build lacks one
+} gather_op_t;
+
+// AVX2 has no scatter
+static const gather_op_t gather_ops[] = {
+    {"gather32", 4, {gather32_scalar,
+#if HAVE_AVX2
+                     gather32_avx2,
+#else
+                     NULL,
+#endif
+#if HAVE_AVX512
+                     gather32_avx512
+#else
+                     NULL
+#endif
+                    }},
+    {"gather64", 8, {gather64_scalar,
+#if HAVE_AVX2
+                     gather64_avx2,
+#else
+                     NULL,
+#endif
+#if HAVE_AVX512
+                     gather64_avx512
+#else
+                     NULL
+#endif
+                    }},
+    {"scatter32", 4, {scatter32_scalar, NULL,
+#if HAVE_AVX512
+                      scatter32_avx512
+#else
+                      NULL
+#endif
+                     }},
+    {"scatter64", 8, {scatter64_scalar, NULL,
+#if HAVE_AVX512
+                      scatter64_avx512
+#else
+                      NULL
+#endif
+                     }},
+};
+
+#define NUM_GATHER_OPS ((int)(sizeof(gather_ops) / sizeof(gather_ops[0])))
+
+static size_t random_index(size_t n) {
+    return (((size_t)rand() << 31) ^ (size_t)rand()) % n;
+}
+
+// count indices into a table of n elements
+static void fill_indices(uint32_t* idx, size_t count, size_t n, index_distribution_t dist) {
+    size_t base = 0;
+    for (size_t i = 0; i < count; i++) {
+        switch (dist) {
+        case INDEX_SEQUENTIAL:
+            idx[i] = (uint32_t)(i % n);
+            break;
+        case INDEX_CLUSTERED:
+            if (i % GATHER_CLUSTER == 0) base = random_index(n);
+            idx[i] = (uint32_t)((base + (size_t)rand() % GATHER_CLUSTER_SPAN) % n);
+            break;
+        default:
+            idx[i] = (uint32_t)random_index(n);
+            break;
+        }
+    }
+}
+
+// ns per element, median of RESULT_SAMPLES runs after one warm-up.
+// Sequential indices span only GATHER_INDICES elements, so on larger tables
+// each run starts one span further on, as in the width suite, and the
+// table's level is what is measured rather than the first span's.
+static double time_gather(gather_kernel_t kernel, char* table, size_t n, size_t element,
+                          const uint32_t* idx, int sequential, double tsc_ghz, double* samples) {
+    size_t window = sequential && n > GATHER_INDICES ? GATHER_INDICES : 0;
+    size_t cursor = 0;
+    for (int s = -1; s < RESULT_SAMPLES; s++) {
+        uint64_t start = get_cycles();
+        gather_sink = kernel(table + cursor * element, idx, GATHER_INDICES);
+        double ns = (double)(get_cycles() - start) / tsc_ghz / GATHER_INDICES;
+        if (s >= 0) samples[s] = ns;
+
+        if (window) {
+            cursor += window;
+            if (cursor + window > n) cursor = 0;
+        }
+    }
+    return median_of_samples(samples, RESULT_SAMPLES);
+}
+
+static void run_gather_test(cachebench_context_t* ctx) {
+    level_limit_t limits[MAX_LEVELS];
+    const char* source;
+    int num_limits = get_cache_limits(ctx, limits, &source);
+
+    // Tables of half of each level, then a multiple of the last level when
+    // MAX_SIZE allows one; 32-bit indices cap the element count
+    size_t sizes[MAX_LEVELS + 1];
+    char names[MAX_LEVELS + 1][8];
+    int num_sizes = 0;
+    for (int l = 0; l <= num_limits; l++) {
+        size_t size;
+        if (l < num_limits) {
+            size = limits[l].capacity / 2;
+            memcpy(names[num_sizes], limits[l].name, sizeof(names[num_sizes]));
+        } else {
+            size = limits[num_limits - 1].capacity * GATHER_DRAM_FACTOR;
+            if (size > MAX_SIZE) size = MAX_SIZE;
+            if (size <= limits[num_limits - 1].capacity) break;
+            strcpy(names[num_sizes], "DRAM");
+        }
+        size &= ~(size_t)(CACHE_LINE_SIZE - 1);
+        if (size < CACHE_LINE_SIZE || (num_sizes > 0 && size <= sizes[num_sizes - 1])) continue;
+        sizes[num_sizes++] = size;
+    }
+
+    char* table = arena_buffer(ctx, sizes[num_sizes - 1]);
+    uint32_t* idx = malloc(GATHER_INDICES * sizeof(uint32_t));
+    if (!table || !idx) {
+        cachebench_printf(ctx, "Failed to allocate memory for gather test\n");
+        free(idx);
+        return;
+    }
+    double tsc_ghz = measure_tsc_ghz();
+
+    cachebench_printf(ctx, "=== Gather and Scatter ===\n");
+    cachebench_printf(ctx, "%d indices per sample, %s cache sizes, %s preconditioning; "
+                      "clustered: %d indices within %d elements\n", GATHER_INDICES, source,
+                      precondition_names[ctx->mode], GATHER_CLUSTER, GATHER_CLUSTER_SPAN);
+    if (!HAVE_AVX2 || !HAVE_AVX512) {
+        cachebench_printf(ctx, "Built without %s: rebuild with -march=native for every kernel\n",
+                          HAVE_AVX2 ? "AVX-512" : "AVX2 and AVX-512");
+    }
+    if (num_sizes <= num_limits) {
+        cachebench_printf(ctx, "DRAM skipped: MAX_SIZE fits in %s\n", limits[num_limits - 1].name);
+    }
+    cachebench_printf(ctx, "\n");
+
+    for (int i = 0; i < num_sizes; i++) {
+        char label[32];
+        format_size(sizes[i], label, sizeof(label));
+        cachebench_printf(ctx, "%s-resident (%s), ns per element\n", names[i], label);
+        cachebench_printf(ctx, "Op\t\tIndices\t\tscalar\tavx2\tavx512\tBest vs scalar\n");
+        cachebench_printf(ctx, "------------------------------------------------------------------------\n");
+
+        for (int op = 0; op < NUM_GATHER_OPS; op++) {
+            const gather_op_t* g = &gather_ops[op];
+            size_t n = sizes[i] / g->element;
+
+            for (int dist = 0; dist < NUM_DISTRIBUTIONS; dist++) {
+                fill_indices(idx, GATHER_INDICES, n, dist);
+                precondition_buffer(ctx, table, sizes[i], ctx->mode);
+
+                double ns[NUM_IMPLS];
+                cachebench_printf(ctx, "%s\t%-10s", g->name, distribution_names[dist]);
+                for (int impl = 0; impl < NUM_IMPLS; impl++) {
+                    ns[impl] = 0;
+                    if (!g->kernels[impl]) {
+                        cachebench_printf(ctx, "\t-");
+                        continue;
+                    }
+                    double samples[RESULT_SAMPLES];
+                    ns[impl] = time_gather(g->kernels[impl], table, n, g->element, idx,
+                                           dist == INDEX_SEQUENTIAL, tsc_ghz, samples);
+                    cachebench_printf(ctx, "\t%.2f", ns[impl]);
+
+                    char params[64];
+                    snprintf(params, sizeof(params), "op=%s,impl=%s,index=%s,size=%zu",
+                             g->name, impl_names[impl], distribution_names[dist], sizes[i]);
+                    record_result(&ctx->results, "gather", params, "ns", samples, RESULT_SAMPLES);
+                }
+
+                int best = -1;
+                for (int impl = IMPL_AVX2; impl < NUM_IMPLS; impl++) {
+                    if (ns[impl] > 0 && (best < 0 || ns[impl] < ns[best])) best = impl;
+                }
+                if (best >= 0) {
+                    cachebench_printf(ctx, "\t%.2fx (%s)\n", ns[IMPL_SCALAR] / ns[best], impl_names[best]);
+                } else {
+                    cachebench_printf(ctx, "\t-\n");
+                }
+            }
+        }
+        cachebench_printf(ctx, "\n");
+    }
+
+    free(idx);
+}
+
+const cachebench_test_t gather_test = {
+    "gather", "Scalar indexed loads vs AVX2/AVX-512 gathers and scatters by index distribution",
+    "op=gather32|gather64|scatter32|scatter64,impl=scalar|avx2|avx512,"
+    "index=sequential|clustered|uniform,size=L1..DRAM", "ns",
+    0, run_gather_test
+};
@@ -0,0 +1,363 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+#define HASH_LOOKUPS (128 * 1024)      // Lookups per sample
+#define HASH_BATCH 16                  // Lookups whose slots are prefetched together
+#define HASH_GROUP 16                  // SwissTable slots per control group
+#define HASH_EMPTY_CTRL 0x80           // Control byte of an empty SwissTable slot
+#define HASH_NO_NODE UINT32_MAX
+#define HASH_LLC_FACTOR 4              // Largest slot array: this many times the LLC
+#define HASH_MAX_TABLE (256UL * 1024 * 1024) // Cap on that, for hosts with huge LLCs
+
+typedef enum {
+    HASH_LINEAR,                       // Open addressing, linear probing
+    HASH_ROBIN_HOOD,                   // Linear probing ordered by probe distance
+    HASH_SWISS,                        // 16-slot groups probed with one SSE2 compare
+    HASH_CHAINED,                      // Bucket heads plus a node pool
+    NUM_HASH_TABLES
+} hash_kind_t;
+
+static const char* hash_names[NUM_HASH_TABLES] = {"linear", "robinhood", "swiss", "chained"};
+
+typedef struct {
+    uint64_t key;                      // 0 marks an empty slot
+    uint64_t value;
+} hash_slot_t;
+
+typedef struct {
+    uint64_t key;
+    uint64_t value;
+    uint32_t next;
+    uint32_t pad;
+} hash_node_t;
+
+typedef struct {
+    hash_kind_t kind;
+    size_t capacity;                   // Slots or buckets, a power of two
+    int shift;                         // 64 - log2(capacity)
+    hash_slot_t* slots;
+    uint8_t* ctrl;                     // SwissTable control bytes
+    uint32_t* heads;                   // Chained bucket heads
+    hash_node_t* nodes;
+    size_t bytes;                      // Footprint of all of the above
+} hash_table_t;
+
+static volatile uint64_t hash_sink;
+
+// Distinct, non-zero, well-mixed keys (splitmix64 finalizer)
+static uint64_t make_key(uint64_t i) {
+    uint64_t z = i + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return z ? z : 1;
+}
+
+static inline uint64_t hash_of(uint64_t key) {
+    return key * 0x9E3779B97F4A7C15ull;
+}
+
+// Home slot (or group, or bucket) from the high bits of the hash
+static inline size_t home_of(const hash_table_t* t, uint64_t key) {
+    return (size_t)(hash_of(key) >> t->shift);
+}
+
+// Lay the table out at the start of buffer; returns the bytes it needs
+static size_t hash_layout(hash_table_t* t, hash_kind_t kind, size_t capacity, size_t entries,
+                          char* buffer) {
+    int log2 = 0;
+    while (((size_t)1 << log2) < capacity) log2++;
+
+    memset(t, 0, sizeof(*t));
+    t->kind = kind;
+    t->capacity = capacity;
+    t->shift = 64 - log2;
+
+    size_t bytes = 0;
+    if (kind == HASH_CHAINED) {
+        t->heads = (uint32_t*)buffer;
+        bytes = capacity * sizeof(uint32_t);
+        bytes = (bytes + CACHE_LINE_SIZE - 1) & ~(size_t)(CACHE_LINE_SIZE - 1);
+        t->nodes = (hash_node_t*)(buffer + bytes);
+        bytes += entries * sizeof(hash_node_t);
+    } else {
+        if (kind == HASH_SWISS) {
+            // Groups are selected by the hash, not slots
+            t->shift = 64 - (log2 - 4);
+            t->ctrl = (uint8_t*)buffer;
+            bytes = capacity;
+        }
+        t->slots = (hash_slot_t*)(buffer + bytes);
+        bytes += capacity * sizeof(hash_slot_t);
+    }
+    t->bytes = bytes;
+    return bytes;
+}
+
+static void hash_clear(hash_table_t* t) {
+    if (t->kind == HASH_CHAINED) {
+        memset(t->heads, 0xFF, t->capacity * sizeof(uint32_t));
+        return;
+    }
+    if (t->ctrl) memset(t->ctrl, HASH_EMPTY_CTRL, t->capacity);
+    memset(t->slots, 0, t->capacity * sizeof(hash_slot_t));
+}
+
+static void hash_insert(hash_table_t* t, uint64_t key, uint64_t value, size_t index) {
+    size_t mask = t->capacity - 1;
+
+    switch (t->kind) {
+    case HASH_LINEAR: {
+        size_t pos = home_of(t, key);
+        while (t->slots[pos].key) pos = (pos + 1) & mask;
+        t->slots[pos] = (hash_slot_t){key, value};
+        break;
+    }
+    case HASH_ROBIN_HOOD: {
+        // Steal the slot of any entry closer to its home than we are to ours
+        hash_slot_t entry = {key, value};
+        size_t pos = home_of(t, key), dist = 0;
+        while (t->slots[pos].key) {
+            size_t existing = (pos - home_of(t, t->slots[pos].key)) & mask;
+            if (existing < dist) {
+                hash_slot_t tmp = t->slots[pos];
+                t->slots[pos] = entry;
+                entry = tmp;
+                dist = existing;
+            }
+            pos = (pos + 1) & mask;
+            dist++;
+        }
+        t->slots[pos] = entry;
+        break;
+    }
+    case HASH_SWISS: {
+        size_t groups_mask = t->capacity / HASH_GROUP - 1;
+        size_t group = home_of(t, key);
+        for (;;) {
+            __m128i ctrl = _mm_loadu_si128((const __m128i*)(t->ctrl + group * HASH_GROUP));
+            int empty = _mm_movemask_epi8(ctrl);
+            if (empty) {
+                size_t pos = group * HASH_GROUP + __builtin_ctz(empty);
+                t->ctrl[pos] = (uint8_t)(hash_of(key) & 0x7F);
+                t->slots[pos] = (hash_slot_t){key, value};
+                return;
+            }
+            group = (group + 1) & groups_mask;
+        }
+    }
+    case HASH_CHAINED: {
+        size_t bucket = home_of(t, key);
+        t->nodes[index] = (hash_node_t){key, value, t->heads[bucket], 0};
+        t->heads[bucket] = (uint32_t)index;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// Returns 1 and adds the value to *sum when key is present
+static inline int hash_find(const hash_table_t* t, uint64_t key, uint64_t* sum) {
+    size_t mask = t->capacity - 1;
+
+    switch (t->kind) {
+    case HASH_LINEAR: {
+        for (size_t pos = home_of(t, key); t->slots[pos].key; pos = (pos + 1) & mask) {
+            if (t->slots[pos].key == key) {
+                *sum += t->slots[pos].value;
+                return 1;
+            }
+        }
+        return 0;
+    }
+    case HASH_ROBIN_HOOD: {
+        // A miss ends at the first entry closer to its home than the probe
+        size_t pos = home_of(t, key);
+        for (size_t dist = 0; t->slots[pos].key; dist++, pos = (pos + 1) & mask) {
+            if (t->slots[pos].key == key) {
+                *sum += t->slots[pos].value;
+                return 1;
+            }
+            if (((pos - home_of(t, t->slots[pos].key)) & mask) < dist) return 0;
+        }
+        return 0;
+    }
+    case HASH_SWISS: {
+        size_t groups_mask = t->capacity / HASH_GROUP - 1;
+        __m128i tag = _mm_set1_epi8((char)(hash_of(key) & 0x7F));
+        for (size_t group = home_of(t, key);; group = (group + 1) & groups_mask) {
+            __m128i ctrl = _mm_loadu_si128((const __m128i*)(t->ctrl + group * HASH_GROUP));
+            for (int match = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, tag)); match; match &= match - 1) {
+                const hash_slot_t* slot = &t->slots[group * HASH_GROUP + __builtin_ctz(match)];
+                if (slot->key == key) {
+                    *sum += slot->value;
+                    return 1;
+                }
+            }
+            if (_mm_movemask_epi8(ctrl)) return 0;
+        }
+    }
+    case HASH_CHAINED: {
+        for (uint32_t n = t->heads[home_of(t, key)]; n != HASH_NO_NODE; n = t->nodes[n].next) {
+            if (t->nodes[n].key == key) {
+                *sum += t->nodes[n].value;
+                return 1;
+            }
+        }
+        return 0;
+    }
+    default:
+        return 0;
+    }
+}
+
+// First line a lookup of key touches
+static inline const void* hash_probe_address(const hash_table_t* t, uint64_t key) {
+    size_t home = home_of(t, key);
+    switch (t->kind) {
+    case HASH_SWISS: return t->ctrl + home * HASH_GROUP;
+    case HASH_CHAINED: return t->heads + home;
+    default: return t->slots + home;
+    }
+}
+
+static size_t lookup_all(const hash_table_t* t, const uint64_t* keys, int count, int batched) {
+    uint64_t sum = 0;
+    size_t found = 0;
+
+    if (!batched) {
+        for (int i = 0; i < count; i++) found += hash_find(t, keys[i], &sum);
+    } else {
+        // Prefetch the home lines of a whole batch, then probe it
+        for (int i = 0; i < count; i += HASH_BATCH) {
+            int end = i + HASH_BATCH < count ? i + HASH_BATCH : count;
+            for (int j = i; j < end; j++) {
+                _mm_prefetch((const char*)hash_probe_address(t, keys[j]), _MM_HINT_T0);
+            }
+            for (int j = i; j < end; j++) found += hash_find(t, keys[j], &sum);
+        }
+    }
+
+    hash_sink = sum;
+    return found;
+}
+
+static double time_lookups(cachebench_context_t* ctx, const hash_table_t* t, char* buffer,
+                           const uint64_t* keys, int batched, size_t expected, double* samples) {
+    double total = 0;
+    for (int s = 0; s < RESULT_SAMPLES; s++) {
+        precondition_buffer(ctx, buffer, t->bytes, ctx->mode);
+        double start_time = get_time_ms();
+        size_t found = lookup_all(t, keys, HASH_LOOKUPS, batched);
+        double ms = get_time_ms() - start_time;
+
+        if (found != expected) {
+            cachebench_printf(ctx, "⚠ %s table found %zu of %zu keys\n",
+                              hash_names[t->kind], found, expected);
+        }
+        samples[s] = ms * 1e6 / HASH_LOOKUPS;
+        total += samples[s];
+    }
+    return total / RESULT_SAMPLES;
+}
+
+static void run_hash_test(cachebench_context_t* ctx) {
+    level_limit_t limits[MAX_LEVELS];
+    const char* source;
+    int num_limits = get_cache_limits(ctx, limits, &source);
+
+    // Slot arrays of each level's size, then a multiple of the last one; the
+    // arena grows past MAX_SIZE to hold it
+    size_t sizes[MAX_LEVELS + 1];
+    int num_sizes = 0;
+    size_t llc = limits[num_limits - 1].capacity;
+    for (int l = 0; l <= num_limits; l++) {
+        size_t size = l < num_limits ? limits[l].capacity : llc * HASH_LLC_FACTOR;
+        if (size > HASH_MAX_TABLE) size = HASH_MAX_TABLE;
+        if (num_sizes == 0 || size > sizes[num_sizes - 1]) sizes[num_sizes++] = size;
+    }
+
+    double load_factors[] = {0.5, 0.75, 0.9, 0.95};
+    int num_factors = sizeof(load_factors) / sizeof(load_factors[0]);
+
+    // Chained tables need a node per entry on top of the bucket array
+    char* buffer = arena_buffer(ctx, sizes[num_sizes - 1] * 2);
+    uint64_t* hit_keys = malloc(HASH_LOOKUPS * sizeof(uint64_t));
+    uint64_t* miss_keys = malloc(HASH_LOOKUPS * sizeof(uint64_t));
+    if (!buffer || !hit_keys || !miss_keys) {
+        cachebench_printf(ctx, "Failed to allocate memory for hash test\n");
+        free(hit_keys);
+        free(miss_keys);
+        return;
+    }
+
+    cachebench_printf(ctx, "=== Hash Table Probing ===\n");
+    cachebench_printf(ctx, "%d lookups per sample, batches of %d with prefetch; %s cache sizes, "
+                      "%s preconditioning\n", HASH_LOOKUPS, HASH_BATCH, source,
+                      precondition_names[ctx->mode]);
+    if (llc * HASH_LLC_FACTOR > HASH_MAX_TABLE) {
+        char cap[32];
+        format_size(HASH_MAX_TABLE, cap, sizeof(cap));
+        cachebench_printf(ctx, "Largest table capped at %s, below %dx LLC\n", cap, HASH_LLC_FACTOR);
+    }
+    cachebench_printf(ctx, "ns/lookup (Mlookups/s for hits in the last column)\n");
+    cachebench_printf(ctx, "Table\t\tSlots\tLF\tBytes\t\tHit\tMiss\tHit+pf\tMiss+pf\tHit Mops/s\n");
+    cachebench_printf(ctx, "------------------------------------------------------------------------------------------\n");
+
+    for (int s = 0; s < num_sizes; s++) {
+        size_t capacity = 1;
+        while (capacity * 2 * sizeof(hash_slot_t) <= sizes[s]) capacity *= 2;
+        if (capacity < 2 * HASH_GROUP) capacity = 2 * HASH_GROUP;
+
+        for (int f = 0; f < num_factors; f++) {
+            size_t entries = (size_t)(capacity * load_factors[f]);
+
+            // Hits in random order over the inserted keys; misses never inserted
+            for (int i = 0; i < HASH_LOOKUPS; i++) {
+                hit_keys[i] = make_key(((size_t)rand() << 16 ^ (size_t)rand()) % entries);
+                miss_keys[i] = make_key(entries + 1 + i);
+            }
+
+            for (int k = 0; k < NUM_HASH_TABLES; k++) {
+                hash_table_t table;
+                hash_layout(&table, k, capacity, entries, buffer);
+                hash_clear(&table);
+                for (size_t i = 0; i < entries; i++) hash_insert(&table, make_key(i), i, i);
+
+                double ns[4];
+                const char* metrics[] = {"hit_ns", "miss_ns", "hit_pf_ns", "miss_pf_ns"};
+                for (int m = 0; m < 4; m++) {
+                    double samples[RESULT_SAMPLES];
+                    int miss = m % 2, batched = m / 2;
+                    ns[m] = time_lookups(ctx, &table, buffer, miss ? miss_keys : hit_keys, batched,
+                                         miss ? 0 : HASH_LOOKUPS, samples);
+
+                    char params[64];
+                    snprintf(params, sizeof(params), "table=%s,slots=%zu,lf=%.2f,mode=%s",
+                             hash_names[k], capacity, load_factors[f], precondition_names[ctx->mode]);
+                    record_result(&ctx->results, "hash", params, metrics[m], samples, RESULT_SAMPLES);
+                }
+
+                char bytes[32];
+                format_size(table.bytes, bytes, sizeof(bytes));
+                cachebench_printf(ctx, "%-9s\t%zu\t%.2f\t%-9s\t%.1f\t%.1f\t%.1f\t%.1f\t%.1f\n",
+                                  hash_names[k], capacity, load_factors[f], bytes,
+                                  ns[0], ns[1], ns[2], ns[3], 1e3 / ns[0]);
+            }
+        }
+    }
+
+    free(hit_keys);
+    free(miss_keys);
+    cachebench_printf(ctx, "\n");
+}
+
+const cachebench_test_t hash_test = {
+    "hash", "Lookups in linear, Robin Hood, SwissTable and chained hash tables",
+    "table=linear|robinhood|swiss|chained,slots=L1..4xLLC (max 256M),lf=0.5..0.95", "hit/miss ns, +prefetch",
+    0, run_hash_test
+};
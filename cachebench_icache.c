@@ -0,0 +1,215 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#define ICACHE_MIN_FOOTPRINT (4 * 1024)
+#define ICACHE_MAX_FOOTPRINT (16 * 1024 * 1024)
+#define ICACHE_INSTRUCTIONS (4 * 1024 * 1024) // Instructions executed per timed sample
+#define ICACHE_BLOCK CACHE_LINE_SIZE   // Chained layouts: one jump target per line
+#define ICACHE_ADD_BYTES 4
+#define ICACHE_JMP_BYTES 5
+
+typedef enum {
+    LAYOUT_STRAIGHT,                   // One run of adds, no branches
+    LAYOUT_CHAINED,                    // Every line jumps to the next one
+    LAYOUT_RANDOM,                     // Every line jumps to a random unvisited line
+    NUM_LAYOUTS
+} code_layout_t;
+
+static const char* layout_names[NUM_LAYOUTS] = {"straight", "chained", "random"};
+
+// add reg, 1 over seven independent registers, so the adds retire as fast
+// as the front end delivers them. All are caller-saved on SysV and Windows.
+#define ICACHE_CHAINS 7
+
+static const unsigned char add_ops[ICACHE_CHAINS][ICACHE_ADD_BYTES] = {
+    {0x48, 0x83, 0xC0, 0x01},          // rax
+    {0x48, 0x83, 0xC1, 0x01},          // rcx
+    {0x48, 0x83, 0xC2, 0x01},          // rdx
+    {0x49, 0x83, 0xC0, 0x01},          // r8
+    {0x49, 0x83, 0xC1, 0x01},          // r9
+    {0x49, 0x83, 0xC2, 0x01},          // r10
+    {0x49, 0x83, 0xC3, 0x01},          // r11
+};
+
+#define OP_RET 0xC3
+#define OP_JMP_REL32 0xE9
+#define OP_INT3 0xCC
+
+typedef void (*code_fn_t)(void);
+
+static unsigned char* emit_adds(unsigned char* p, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        memcpy(p, add_ops[i % ICACHE_CHAINS], ICACHE_ADD_BYTES);
+        p += ICACHE_ADD_BYTES;
+    }
+    return p;
+}
+
+// Write footprint bytes of code for layout into code and return the
+// instructions one call executes. Chained blocks are adds, a jmp to the
+// next block in visiting order and int3 padding; the last block returns.
+static size_t generate_code(unsigned char* code, size_t footprint, code_layout_t layout) {
+    if (layout == LAYOUT_STRAIGHT) {
+        size_t adds = footprint / ICACHE_ADD_BYTES;
+        emit_adds(code, adds)[0] = OP_RET;
+        return adds + 1;
+    }
+
+    size_t num_blocks = footprint / ICACHE_BLOCK;
+    size_t adds = (ICACHE_BLOCK - ICACHE_JMP_BYTES) / ICACHE_ADD_BYTES;
+    size_t* order = malloc(num_blocks * sizeof(size_t));
+    if (!order) return 0;
+    for (size_t i = 0; i < num_blocks; i++) order[i] = i;
+    if (layout == LAYOUT_RANDOM) {
+        // Visit the entry block first so calls always start at code
+        for (size_t i = num_blocks - 1; i > 1; i--) {
+            size_t j = 1 + (((size_t)rand() << 31) ^ (size_t)rand()) % i;
+            size_t tmp = order[i];
+            order[i] = order[j];
+            order[j] = tmp;
+        }
+    }
+
+    memset(code, OP_INT3, footprint);
+    for (size_t i = 0; i < num_blocks; i++) {
+        unsigned char* block = code + order[i] * ICACHE_BLOCK;
+        unsigned char* p = emit_adds(block, adds);
+        if (i == num_blocks - 1) {
+            *p = OP_RET;
+            continue;
+        }
+        unsigned char* target = code + order[i + 1] * ICACHE_BLOCK;
+        int32_t rel = (int32_t)(target - (p + ICACHE_JMP_BYTES));
+        p[0] = OP_JMP_REL32;
+        memcpy(p + 1, &rel, sizeof(rel));
+    }
+    free(order);
+    return num_blocks * (adds + 1);
+}
+
+typedef struct {
+    double cpi;
+    double l1i_mpki;                   // Misses per 1000 instructions, -1 without counters
+    double itlb_mpki;
+} icache_point_t;
+
+// TSC cycles per instruction over RESULT_SAMPLES samples after one warm-up
+// call; counters cover the timed samples
+static icache_point_t time_code(code_fn_t fn, size_t instructions, int l1i_fd, int itlb_fd,
+                                double* samples) {
+    size_t calls = ICACHE_INSTRUCTIONS / instructions;
+    if (calls < 1) calls = 1;
+
+    fn();
+    counter_start(l1i_fd);
+    counter_start(itlb_fd);
+    for (int s = 0; s < RESULT_SAMPLES; s++) {
+        uint64_t start = get_cycles();
+        for (size_t c = 0; c < calls; c++) fn();
+        samples[s] = (double)(get_cycles() - start) / ((double)calls * instructions);
+    }
+    uint64_t l1i = counter_stop(l1i_fd);
+    uint64_t itlb = counter_stop(itlb_fd);
+
+    double kilo = (double)calls * instructions * RESULT_SAMPLES / 1000.0;
+    icache_point_t point;
+    point.cpi = median_of_samples(samples, RESULT_SAMPLES);
+    point.l1i_mpki = l1i_fd >= 0 ? l1i / kilo : -1;
+    point.itlb_mpki = itlb_fd >= 0 ? itlb / kilo : -1;
+    return point;
+}
+
+static void run_icache_test(cachebench_context_t* ctx) {
+#if defined(_WIN32) || !defined(__x86_64__)
+    cachebench_printf(ctx, "Instruction cache test generates x86-64 code; not supported on this platform\n\n");
+#else
+    size_t region = ICACHE_MAX_FOOTPRINT + 4096;
+    unsigned char* code = mmap(NULL, region, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (code == MAP_FAILED) {
+        cachebench_printf(ctx, "Failed to map memory for instruction cache test\n");
+        return;
+    }
+
+    size_t sizes[MAX_SWEEP_POINTS];
+    int num_sizes = generate_sweep(&(sweep_config_t){ICACHE_MIN_FOOTPRINT, ICACHE_MAX_FOOTPRINT, 1, 0},
+                                   sizes, MAX_SWEEP_POINTS);
+    int l1i_fd = counter_open(COUNTER_L1I_MISSES);
+    int itlb_fd = counter_open(COUNTER_ITLB_MISSES);
+    int counters = l1i_fd >= 0 || itlb_fd >= 0;
+
+    cachebench_printf(ctx, "=== Instruction Cache and iTLB ===\n");
+    cachebench_printf(ctx, "Generated code: %d-byte adds, chained layouts jump once per %d-byte line; "
+                      "TSC cycles per instruction\n", ICACHE_ADD_BYTES, ICACHE_BLOCK);
+    if (counters) {
+        cachebench_printf(ctx, "Misses per 1000 instructions (MPKI) for the random layout\n");
+    } else {
+        cachebench_printf(ctx, "L1I/iTLB counters unavailable (perf_event_open failed)\n");
+    }
+    cachebench_printf(ctx, "Footprint\tStraight\tChained\t\tRandom%s\n",
+                      counters ? "\t\tL1I MPKI\tiTLB MPKI" : "");
+    cachebench_printf(ctx, "------------------------------------------------------------%s\n",
+                      counters ? "--------------------------------" : "");
+
+    for (int i = 0; i < num_sizes; i++) {
+        size_t footprint = sizes[i] & ~(size_t)(ICACHE_BLOCK - 1);
+        icache_point_t points[NUM_LAYOUTS];
+        int failed = 0;
+
+        for (int layout = 0; layout < NUM_LAYOUTS && !failed; layout++) {
+            size_t instructions = 0;
+            if (mprotect(code, region, PROT_READ | PROT_WRITE) == 0) {
+                instructions = generate_code(code, footprint, layout);
+            }
+            if (instructions == 0 || mprotect(code, region, PROT_READ | PROT_EXEC) != 0) {
+                failed = 1;
+                break;
+            }
+
+            double samples[RESULT_SAMPLES];
+            points[layout] = time_code((code_fn_t)(void*)code, instructions, l1i_fd, itlb_fd, samples);
+
+            char params[64];
+            snprintf(params, sizeof(params), "layout=%s,footprint=%zu", layout_names[layout], footprint);
+            record_result(&ctx->results, "icache", params, "cycles", samples, RESULT_SAMPLES);
+            if (points[layout].l1i_mpki >= 0) {
+                record_result(&ctx->results, "icache", params, "l1i_mpki", &points[layout].l1i_mpki, 1);
+            }
+            if (points[layout].itlb_mpki >= 0) {
+                record_result(&ctx->results, "icache", params, "itlb_mpki", &points[layout].itlb_mpki, 1);
+            }
+        }
+        if (failed) {
+            cachebench_printf(ctx, "Cannot generate executable code (W^X policy?)\n");
+            break;
+        }
+
+        char label[32];
+        format_size(footprint, label, sizeof(label));
+        cachebench_printf(ctx, "%s\t\t%.3f\t\t%.3f\t\t%.3f", label, points[LAYOUT_STRAIGHT].cpi,
+                          points[LAYOUT_CHAINED].cpi, points[LAYOUT_RANDOM].cpi);
+        if (counters) {
+            cachebench_printf(ctx, "\t\t%.2f\t\t%.2f", points[LAYOUT_RANDOM].l1i_mpki,
+                              points[LAYOUT_RANDOM].itlb_mpki);
+        }
+        cachebench_printf(ctx, "\n");
+    }
+    cachebench_printf(ctx, "\n");
+
+    counter_close(l1i_fd);
+    counter_close(itlb_fd);
+    munmap(code, region);
+#endif
+}
+
+const cachebench_test_t icache_test = {
+    "icache", "Generated straight-line and jump-chained code, 4KB-16MB: CPI and L1I/iTLB misses",
+    "layout=straight|chained|random,footprint=4K..16M", "cycles,l1i_mpki,itlb_mpki",
+    0, run_icache_test
+};
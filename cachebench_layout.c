@@ -0,0 +1,186 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LAYOUT_MIN_RECORD 16
+#define LAYOUT_MAX_RECORD 256
+#define LAYOUT_BLOCK 16                // AoSoA records per block: one 64-byte line per field
+#define LAYOUT_SCAN_BYTES (16 * 1024 * 1024) // Minimum bytes scanned per sample
+#define LAYOUT_PULL_RECORDS 1024       // Records simulated for bytes pulled; a whole period
+
+typedef enum {
+    LAYOUT_AOS,                        // Records stored whole, one after another
+    LAYOUT_SOA,                        // One array per field
+    LAYOUT_AOSOA,                      // LAYOUT_BLOCK records per block, field-major inside
+    NUM_LAYOUTS
+} layout_t;
+
+static const char* layout_names[NUM_LAYOUTS] = {"aos", "soa", "aosoa"};
+
+static volatile uint32_t layout_sink;
+
+// Sum the first fields fields of every record
+static void scan_aos(const uint32_t* data, size_t records, int record_fields, int fields) {
+    uint32_t sum = 0;
+    for (size_t r = 0; r < records; r++) {
+        const uint32_t* record = data + r * record_fields;
+        for (int f = 0; f < fields; f++) sum += record[f];
+    }
+    layout_sink = sum;
+}
+
+static void scan_soa(const uint32_t* data, size_t records, int fields) {
+    uint32_t sum = 0;
+    for (int f = 0; f < fields; f++) {
+        const uint32_t* column = data + (size_t)f * records;
+        for (size_t r = 0; r < records; r++) sum += column[r];
+    }
+    layout_sink = sum;
+}
+
+static void scan_aosoa(const uint32_t* data, size_t records, int record_fields, int fields) {
+    uint32_t sum = 0;
+    for (size_t b = 0; b < records / LAYOUT_BLOCK; b++) {
+        const uint32_t* block = data + b * LAYOUT_BLOCK * record_fields;
+        for (int f = 0; f < fields; f++) {
+            const uint32_t* lane = block + f * LAYOUT_BLOCK;
+            for (int r = 0; r < LAYOUT_BLOCK; r++) sum += lane[r];
+        }
+    }
+    layout_sink = sum;
+}
+
+// Byte offset of field f of record r
+static size_t field_offset(layout_t layout, size_t r, int f, size_t records, int record_fields) {
+    switch (layout) {
+    case LAYOUT_AOS:
+        return (r * record_fields + f) * sizeof(uint32_t);
+    case LAYOUT_SOA:
+        return ((size_t)f * records + r) * sizeof(uint32_t);
+    default:
+        return ((r / LAYOUT_BLOCK) * LAYOUT_BLOCK * record_fields + (size_t)f * LAYOUT_BLOCK +
+                r % LAYOUT_BLOCK) * sizeof(uint32_t);
+    }
+}
+
+static void count_line(size_t offset, size_t* last, size_t* lines) {
+    size_t line = offset / CACHE_LINE_SIZE;
+    if (line != *last) {
+        (*lines)++;
+        *last = line;
+    }
+}
+
+// Cache lines a scan pulls in, counted over the exact addresses it touches
+// in its own loop order (every layout walks memory in ascending order)
+static size_t lines_touched(layout_t layout, size_t records, int record_fields, int fields) {
+    size_t lines = 0, last = (size_t)-1;
+    if (layout == LAYOUT_SOA) {
+        for (int f = 0; f < fields; f++)
+            for (size_t r = 0; r < records; r++)
+                count_line(field_offset(layout, r, f, records, record_fields), &last, &lines);
+    } else if (layout == LAYOUT_AOSOA) {
+        for (size_t b = 0; b < records; b += LAYOUT_BLOCK)
+            for (int f = 0; f < fields; f++)
+                for (size_t r = b; r < b + LAYOUT_BLOCK && r < records; r++)
+                    count_line(field_offset(layout, r, f, records, record_fields), &last, &lines);
+    } else {
+        for (size_t r = 0; r < records; r++)
+            for (int f = 0; f < fields; f++)
+                count_line(field_offset(layout, r, f, records, record_fields), &last, &lines);
+    }
+    return lines;
+}
+
+static double time_scan(cachebench_context_t* ctx, layout_t layout, char* buffer, size_t size,
+                        size_t records, int record_fields, int fields, double* samples) {
+    int passes = (int)(LAYOUT_SCAN_BYTES / size);
+    if (passes < 1) passes = 1;
+
+    double total = 0;
+    for (int s = 0; s < RESULT_SAMPLES; s++) {
+        precondition_buffer(ctx, buffer, size, ctx->mode);
+        double start_time = get_time_ms();
+        for (int p = 0; p < passes; p++) {
+            const uint32_t* data = (const uint32_t*)buffer;
+            if (layout == LAYOUT_AOS) scan_aos(data, records, record_fields, fields);
+            else if (layout == LAYOUT_SOA) scan_soa(data, records, fields);
+            else scan_aosoa(data, records, record_fields, fields);
+        }
+        double ms = get_time_ms() - start_time;
+        samples[s] = ms * 1e6 / ((double)records * passes);
+        total += samples[s];
+    }
+    return total / RESULT_SAMPLES;
+}
+
+static void run_layout_test(cachebench_context_t* ctx) {
+    level_limit_t limits[MAX_LEVELS];
+    const char* source;
+    int num_limits = get_cache_limits(ctx, limits, &source);
+
+    // Half of each level, then twice the last one for DRAM
+    size_t sets[MAX_LEVELS + 1];
+    int num_sets = 0;
+    for (int l = 0; l <= num_limits; l++) {
+        size_t size = l < num_limits ? limits[l].capacity / 2 : limits[num_limits - 1].capacity * 2;
+        if (size > MAX_SIZE) size = MAX_SIZE;
+        size -= size % (LAYOUT_MAX_RECORD * LAYOUT_BLOCK);
+        if (num_sets == 0 || size > sets[num_sets - 1]) sets[num_sets++] = size;
+    }
+
+    char* buffer = arena_buffer(ctx, sets[num_sets - 1]);
+    if (!buffer) return;
+
+    cachebench_printf(ctx, "=== Data Layout: AoS vs SoA vs AoSoA ===\n");
+    cachebench_printf(ctx, "4-byte fields; AoSoA blocks of %d records (one line per field); "
+                      "%s cache sizes, %s preconditioning\n",
+                      LAYOUT_BLOCK, source, precondition_names[ctx->mode]);
+    cachebench_printf(ctx, "ns/record and bytes pulled per record (whole lines touched)\n");
+    cachebench_printf(ctx, "Record\tSet\t\tFields\tAoS ns\tSoA ns\tAoSoA ns\tAoS B\tSoA B\tAoSoA B\n");
+    cachebench_printf(ctx, "----------------------------------------------------------------------------------------\n");
+
+    for (int record_size = LAYOUT_MIN_RECORD; record_size <= LAYOUT_MAX_RECORD; record_size *= 2) {
+        int record_fields = record_size / sizeof(uint32_t);
+        int touched[] = {1, record_fields / 2, record_fields};
+
+        for (int s = 0; s < num_sets; s++) {
+            size_t records = sets[s] / record_size;
+            char set_label[32];
+            format_size(sets[s], set_label, sizeof(set_label));
+
+            for (int t = 0; t < 3; t++) {
+                if (t > 0 && touched[t] == touched[t - 1]) continue;
+                int fields = touched[t];
+
+                double ns[NUM_LAYOUTS], pulled[NUM_LAYOUTS];
+                for (int l = 0; l < NUM_LAYOUTS; l++) {
+                    double samples[RESULT_SAMPLES];
+                    ns[l] = time_scan(ctx, l, buffer, sets[s], records, record_fields, fields, samples);
+                    size_t sample = records < LAYOUT_PULL_RECORDS ? records : LAYOUT_PULL_RECORDS;
+                    pulled[l] = (double)lines_touched(l, sample, record_fields, fields) *
+                                CACHE_LINE_SIZE / sample;
+
+                    char params[64];
+                    snprintf(params, sizeof(params), "record=%d,fields=%d,size=%zu,layout=%s,mode=%s",
+                             record_size, fields, sets[s], layout_names[l],
+                             precondition_names[ctx->mode]);
+                    record_result(&ctx->results, "layout", params, "ns", samples, RESULT_SAMPLES);
+                }
+
+                cachebench_printf(ctx, "%d B\t%s\t\t%d/%d\t%.2f\t%.2f\t%.2f\t\t%.0f\t%.0f\t%.0f\n",
+                                  record_size, set_label, fields, record_fields,
+                                  ns[LAYOUT_AOS], ns[LAYOUT_SOA], ns[LAYOUT_AOSOA],
+                                  pulled[LAYOUT_AOS], pulled[LAYOUT_SOA], pulled[LAYOUT_AOSOA]);
+            }
+        }
+    }
+    cachebench_printf(ctx, "\n");
+}
+
+const cachebench_test_t layout_test = {
+    "layout", "Scan cost of AoS, SoA and AoSoA records touching 1, half or all fields",
+    "record=16..256,fields,size=L1/2..2xLLC,layout=aos|soa|aosoa", "ns",
+    0, run_layout_test
+};
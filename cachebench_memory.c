@@ -0,0 +1,503 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Sequential access benchmark
+double benchmark_sequential_access(void* buffer, size_t size, int iterations) {
+    volatile char* ptr = (volatile char*)buffer;
+    volatile char dummy;
+    
+    double start_time = get_time_ms();
+    
+    for (int i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < size; j += CACHE_LINE_SIZE) {
+            dummy = ptr[j];
+        }
+    }
+    
+    double end_time = get_time_ms();
+    return end_time - start_time;
+}
+
+// Random access pattern over size bytes, one offset per size_t element.
+// Built ahead of preconditioning so generating it does not disturb the
+// cache state being measured.
+size_t* create_random_indices(size_t size) {
+    size_t num_elements = size / sizeof(size_t);
+    size_t* indices = malloc(num_elements * sizeof(size_t));
+    if (!indices) return NULL;
+    
+    for (size_t i = 0; i < num_elements; i++) {
+        indices[i] = (rand() % num_elements) * sizeof(size_t);
+    }
+    return indices;
+}
+
+double benchmark_random_pattern(void* buffer, const size_t* indices, size_t size, int iterations) {
+    volatile char* ptr = (volatile char*)buffer;
+    volatile char dummy;
+    size_t num_elements = size / sizeof(size_t);
+    
+    double start_time = get_time_ms();
+    
+    for (int i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < num_elements; j++) {
+            dummy = ptr[indices[j]];
+        }
+    }
+    
+    double end_time = get_time_ms();
+    return end_time - start_time;
+}
+
+// Random access benchmark
+double benchmark_random_access(void* buffer, size_t size, int iterations) {
+    size_t* indices = create_random_indices(size);
+    if (!indices) return -1;
+    
+    double time = benchmark_random_pattern(buffer, indices, size, iterations);
+    free(indices);
+    return time;
+}
+
+// Link the cache lines of the first size bytes of buffer into one random
+// cycle (Sattolo's algorithm) so every load depends on the previous one and
+// the prefetchers cannot predict the next line. Returns the chain start.
+void** build_pointer_chain(void* buffer, size_t size) {
+    size_t num_lines = size / CACHE_LINE_SIZE;
+    size_t* order = malloc(num_lines * sizeof(size_t));
+    if (!order) return NULL;
+    
+    for (size_t i = 0; i < num_lines; i++) order[i] = i;
+    for (size_t i = num_lines - 1; i > 0; i--) {
+        size_t j = (((size_t)rand() << 31) ^ (size_t)rand()) % i;
+        size_t tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    
+    char* base = (char*)buffer;
+    for (size_t i = 0; i < num_lines; i++) {
+        size_t next = order[(i + 1) % num_lines];
+        *(void**)(base + order[i] * CACHE_LINE_SIZE) = base + next * CACHE_LINE_SIZE;
+    }
+    
+    void** start = (void**)(base + order[0] * CACHE_LINE_SIZE);
+    free(order);
+    return start;
+}
+
+// Stride access benchmark to test cache line effects
+double benchmark_stride_access(void* buffer, size_t size, int stride, int iterations) {
+    volatile char* ptr = (volatile char*)buffer;
+    volatile char dummy;
+    
+    double start_time = get_time_ms();
+    
+    for (int i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < size; j += stride) {
+            dummy = ptr[j];
+        }
+    }
+    
+    double end_time = get_time_ms();
+    return end_time - start_time;
+}
+
+// Memory write benchmark
+double benchmark_write_access(void* buffer, size_t size, int iterations) {
+    volatile char* ptr = (volatile char*)buffer;
+    
+    double start_time = get_time_ms();
+    
+    for (int i = 0; i < iterations; i++) {
+        for (size_t j = 0; j < size; j += CACHE_LINE_SIZE) {
+            ptr[j] = (char)(i + j);
+        }
+    }
+    
+    double end_time = get_time_ms();
+    return end_time - start_time;
+}
+
+// Cache associativity test
+double benchmark_associativity(void* buffer, size_t cache_size, int ways, int iterations) {
+    size_t stride = cache_size / ways;
+    volatile char* ptr = (volatile char*)buffer;
+    volatile char dummy;
+    
+    double start_time = get_time_ms();
+    
+    for (int i = 0; i < iterations; i++) {
+        for (int w = 0; w < ways + 1; w++) {
+            dummy = ptr[w * stride];
+        }
+    }
+    
+    double end_time = get_time_ms();
+    return end_time - start_time;
+}
+
+static void run_latency_test(cachebench_context_t* ctx) {
+    precondition_t mode = ctx->mode;
+    
+    cachebench_printf(ctx, "=== Memory Latency Test ===\n");
+    cachebench_printf(ctx, "Preconditioning: %s (first pass timed separately)\n", precondition_names[mode]);
+    cachebench_printf(ctx, "Size\t\tSequential (ms)\tRandom (ms)\tBandwidth (GB/s)\t1st Seq (ns)\t1st Rand (ns)\n");
+    cachebench_printf(ctx, "------------------------------------------------------------------------------------------\n");
+    
+    size_t sizes[MAX_SWEEP_POINTS];
+    int num_sizes = generate_sweep(&ctx->latency_sweep, sizes, MAX_SWEEP_POINTS);
+    
+    // Each point measures a prefix of the arena
+    char* buffer = arena_buffer(ctx, sizes[num_sizes - 1]);
+    if (!buffer) return;
+    
+    for (int i = 0; i < num_sizes; i++) {
+        size_t size = sizes[i];
+        
+        int iterations = ctx->iterations / (size / MIN_SIZE + 1);
+        if (iterations < 100) iterations = 100;
+        
+        double seq_first, rand_first;
+        double seq_samples[RESULT_SAMPLES], rand_samples[RESULT_SAMPLES];
+        double seq_time = run_line_kernel(ctx, benchmark_sequential_access, buffer, size, iterations,
+                                          &seq_first, seq_samples);
+        double rand_time = run_random_kernel(ctx, buffer, size, iterations,
+                                             &rand_first, rand_samples);
+        
+        double bandwidth = (double)(size * iterations) / (seq_time / 1000.0) / (1024*1024*1024);
+        record_curve_point(ctx, size, seq_time, rand_time, iterations);
+        
+        char params[64];
+        snprintf(params, sizeof(params), "size=%zu,mode=%s", size, precondition_names[mode]);
+        record_result(&ctx->results, "latency", params, "seq_ns", seq_samples, RESULT_SAMPLES);
+        record_result(&ctx->results, "latency", params, "rand_ns", rand_samples, RESULT_SAMPLES);
+        
+        char label[32];
+        format_size(size, label, sizeof(label));
+        cachebench_printf(ctx, "%s\t\t%.2f\t\t%.2f\t\t%.2f\t\t\t%.2f\t\t%.2f\n",
+                          label, seq_time, rand_time, bandwidth, seq_first, rand_first);
+    }
+    
+    cachebench_printf(ctx, "\n");
+}
+
+static void run_stride_test(cachebench_context_t* ctx) {
+    precondition_t mode = ctx->mode;
+    
+    cachebench_printf(ctx, "=== Cache Line Stride Test ===\n");
+    cachebench_printf(ctx, "Testing with 1MB buffer, %s preconditioning\n", precondition_names[mode]);
+    cachebench_printf(ctx, "Stride\t\tTime (ms)\tEfficiency\n");
+    cachebench_printf(ctx, "----------------------------------\n");
+    
+    size_t test_size = 1024 * 1024;
+    char* buffer = arena_buffer(ctx, test_size);
+    if (!buffer) return;
+    
+    precondition_buffer(ctx, buffer, test_size, mode);
+    double baseline_time = benchmark_stride_access(buffer, test_size, 1, ctx->iterations / 100);
+    
+    int strides[] = {1, 2, 4, 8, 16, 32, 64, 128, 256, 512};
+    int num_strides = sizeof(strides) / sizeof(strides[0]);
+    
+    for (int i = 0; i < num_strides; i++) {
+        int iterations = ctx->iterations / 100;
+        double accesses = (double)((test_size + strides[i] - 1) / strides[i]);
+        double samples[RESULT_SAMPLES];
+        double time = 0;
+        
+        precondition_buffer(ctx, buffer, test_size, mode);
+        for (int c = 0; c < RESULT_SAMPLES; c++) {
+            int n = chunk_iterations(iterations, c);
+            double ms = benchmark_stride_access(buffer, test_size, strides[i], n);
+            samples[c] = ms * 1e6 / (accesses * n);
+            time += ms;
+        }
+        double efficiency = baseline_time / time * 100.0;
+        
+        char params[64];
+        snprintf(params, sizeof(params), "stride=%d,mode=%s", strides[i], precondition_names[mode]);
+        record_result(&ctx->results, "stride", params, "ns", samples, RESULT_SAMPLES);
+        
+        if (strides[i] == CACHE_LINE_SIZE) ctx->line_stride_efficiency = efficiency;
+        
+        cachebench_printf(ctx, "%d\t\t%.2f\t\t%.1f%%\n", strides[i], time, efficiency);
+    }
+    
+    cachebench_printf(ctx, "\n");
+}
+
+// Precondition twice the cache size and time the associativity kernel
+static double time_associativity(cachebench_context_t* ctx, size_t cache_size, int ways) {
+    size_t total_size = cache_size * 2;
+    char* buffer = arena_buffer(ctx, total_size);
+    
+    if (!buffer) {
+        cachebench_printf(ctx, "Failed to allocate memory for associativity test\n");
+        return -1;
+    }
+    
+    precondition_buffer(ctx, buffer, total_size, ctx->mode);
+    return benchmark_associativity(buffer, cache_size, ways, ctx->iterations / 10);
+}
+
+static void run_cache_thrashing_test(cachebench_context_t* ctx) {
+    cachebench_printf(ctx, "=== Cache Thrashing Test ===\n");
+    cachebench_printf(ctx, "Testing cache associativity limits, %s preconditioning\n",
+                      precondition_names[ctx->mode]);
+    cachebench_printf(ctx, "Cache Level\tTime (ms)\tThrashing Factor\n");
+    cachebench_printf(ctx, "------------------------------------------\n");
+    
+    // Test L1 cache thrashing
+    double l1_normal = time_associativity(ctx, L1_CACHE_SIZE, 8);
+    double l1_thrash = time_associativity(ctx, L1_CACHE_SIZE, 16);
+    cachebench_printf(ctx, "L1 (32KB)\t%.2f\t\t%.2fx\n", l1_normal, l1_thrash / l1_normal);
+    
+    // Test L2 cache thrashing
+    double l2_normal = time_associativity(ctx, L2_CACHE_SIZE, 8);
+    double l2_thrash = time_associativity(ctx, L2_CACHE_SIZE, 16);
+    cachebench_printf(ctx, "L2 (512KB)\t%.2f\t\t%.2fx\n", l2_normal, l2_thrash / l2_normal);
+    
+    // Test L3 cache thrashing
+    double l3_normal = time_associativity(ctx, L3_CACHE_SIZE, 16);
+    double l3_thrash = time_associativity(ctx, L3_CACHE_SIZE, 32);
+    cachebench_printf(ctx, "L3 (32MB)\t%.2f\t\t%.2fx\n", l3_normal, l3_thrash / l3_normal);
+    
+    // Single timings: stored for trend inspection, too few for significance
+    const char* mode = precondition_names[ctx->mode];
+    double times[] = {l1_normal, l1_thrash, l2_normal, l2_thrash, l3_normal, l3_thrash};
+    const char* levels[] = {"L1", "L1", "L2", "L2", "L3", "L3"};
+    int ways[] = {8, 16, 8, 16, 16, 32};
+    for (int i = 0; i < 6; i++) {
+        char params[64];
+        snprintf(params, sizeof(params), "level=%s,ways=%d,mode=%s", levels[i], ways[i], mode);
+        record_result(&ctx->results, "thrashing", params, "ms", &times[i], 1);
+    }
+    
+    cachebench_printf(ctx, "\n");
+}
+
+static void run_read_write_comparison(cachebench_context_t* ctx) {
+    precondition_t mode = ctx->mode;
+    
+    cachebench_printf(ctx, "=== Read vs Write Performance ===\n");
+    cachebench_printf(ctx, "Preconditioning: %s (first pass timed separately)\n", precondition_names[mode]);
+    cachebench_printf(ctx, "Size\t\tRead (ms)\tWrite (ms)\tWrite/Read Ratio\t1st Read (ns)\t1st Write (ns)\n");
+    cachebench_printf(ctx, "------------------------------------------------------------------------------------------\n");
+    
+    size_t sizes[] = {L1_CACHE_SIZE, L2_CACHE_SIZE, L3_CACHE_SIZE, L3_CACHE_SIZE * 2};
+    const char* labels[] = {"L1 (32KB)", "L2 (512KB)", "L3 (32MB)", "RAM (64MB)"};
+    
+    for (int i = 0; i < 4; i++) {
+        char* buffer = arena_buffer(ctx, sizes[i]);
+        if (!buffer) continue;
+        
+        int iterations = ctx->iterations / (sizes[i] / MIN_SIZE + 1);
+        if (iterations < 100) iterations = 100;
+        
+        double read_first, write_first;
+        double read_samples[RESULT_SAMPLES], write_samples[RESULT_SAMPLES];
+        double read_time = run_line_kernel(ctx, benchmark_sequential_access, buffer, sizes[i],
+                                           iterations, &read_first, read_samples);
+        double write_time = run_line_kernel(ctx, benchmark_write_access, buffer, sizes[i],
+                                            iterations, &write_first, write_samples);
+        
+        char params[64];
+        snprintf(params, sizeof(params), "size=%zu,mode=%s", sizes[i], precondition_names[mode]);
+        record_result(&ctx->results, "readwrite", params, "read_ns", read_samples, RESULT_SAMPLES);
+        record_result(&ctx->results, "readwrite", params, "write_ns", write_samples, RESULT_SAMPLES);
+        
+        cachebench_printf(ctx, "%s\t\t%.2f\t\t%.2f\t\t%.2f\t\t\t%.2f\t\t%.2f\n", 
+                          labels[i], read_time, write_time, write_time / read_time, read_first, write_first);
+    }
+    cachebench_printf(ctx, "\n");
+}
+
+static void run_detailed_l3_test(cachebench_context_t* ctx) {
+    precondition_t mode = ctx->mode;
+    
+    cachebench_printf(ctx, "=== Detailed L3 Cache Investigation ===\n");
+    cachebench_printf(ctx, "Testing fine-grained sizes around L3 boundaries, %s preconditioning\n",
+                      precondition_names[mode]);
+    cachebench_printf(ctx, "Size\t\tSeq (ms)\tRand (ms)\tLatency Ratio\t1st Seq (ns)\t1st Rand (ns)\n");
+    cachebench_printf(ctx, "--------------------------------------------------------------------------------\n");
+    
+    size_t test_sizes[MAX_SWEEP_POINTS];
+    int num_sizes = generate_sweep(&ctx->l3_sweep, test_sizes, MAX_SWEEP_POINTS);
+    
+    char* buffer = arena_buffer(ctx, test_sizes[num_sizes - 1]);
+    if (!buffer) return;
+    
+    double baseline_seq = 0, baseline_rand = 0;
+    
+    for (int i = 0; i < num_sizes; i++) {
+        int iterations = ctx->iterations / (test_sizes[i] / MIN_SIZE + 1);
+        if (iterations < 50) iterations = 50;
+        
+        double seq_first, rand_first;
+        double seq_samples[RESULT_SAMPLES], rand_samples[RESULT_SAMPLES];
+        double seq_time = run_line_kernel(ctx, benchmark_sequential_access, buffer, test_sizes[i],
+                                          iterations, &seq_first, seq_samples);
+        double rand_time = run_random_kernel(ctx, buffer, test_sizes[i], iterations,
+                                             &rand_first, rand_samples);
+        
+        char params[64];
+        snprintf(params, sizeof(params), "size=%zu,mode=%s", test_sizes[i], precondition_names[mode]);
+        record_result(&ctx->results, "l3", params, "seq_ns", seq_samples, RESULT_SAMPLES);
+        record_result(&ctx->results, "l3", params, "rand_ns", rand_samples, RESULT_SAMPLES);
+        record_curve_point(ctx, test_sizes[i], seq_time, rand_time, iterations);
+        
+        if (i == 0) {
+            baseline_seq = seq_time;
+            baseline_rand = rand_time;
+        }
+        
+        double seq_ratio = seq_time / baseline_seq;
+        double rand_ratio = rand_time / baseline_rand;
+        
+        char label[32];
+        format_size(test_sizes[i], label, sizeof(label));
+        cachebench_printf(ctx, "%s\t\t%.2f\t\t%.2f\t\t%.2fx/%.2fx\t%.2f\t\t%.2f\n", 
+                          label, seq_time, rand_time, seq_ratio, rand_ratio, seq_first, rand_first);
+    }
+    
+    cachebench_printf(ctx, "\n");
+}
+
+static void print_histogram_ascii(cachebench_context_t* ctx, const latency_histogram_t* hist,
+                                  double tsc_ghz) {
+    uint64_t rows[HIST_BUCKETS / HIST_DISPLAY_GROUP] = {0};
+    uint64_t peak = 0;
+    int first = -1, last = -1;
+    
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+        if (!hist->counts[b]) continue;
+        int row = b / HIST_DISPLAY_GROUP;
+        rows[row] += hist->counts[b];
+        if (rows[row] > peak) peak = rows[row];
+        if (first < 0) first = row;
+        last = row;
+    }
+    
+    for (int row = first; row >= 0 && row <= last; row++) {
+        uint64_t low = histogram_bucket_low(row * HIST_DISPLAY_GROUP);
+        uint64_t high = histogram_bucket_high(row * HIST_DISPLAY_GROUP + HIST_DISPLAY_GROUP - 1);
+        int width = (int)((double)rows[row] / peak * HIST_BAR_WIDTH + 0.5);
+        if (rows[row] && width == 0) width = 1;
+        
+        cachebench_printf(ctx, "  %6llu-%-6llu cyc %8.1f ns %6.2f%% |",
+                          (unsigned long long)low, (unsigned long long)high, low / tsc_ghz,
+                          100.0 * rows[row] / hist->total);
+        for (int i = 0; i < width; i++) cachebench_printf(ctx, "#");
+        cachebench_printf(ctx, "\n");
+    }
+}
+
+static void run_latency_histogram(cachebench_context_t* ctx) {
+    precondition_t mode = ctx->mode;
+    int samples = ctx->histogram.samples;
+    int batch = ctx->histogram.batch;
+    int csv = ctx->histogram.csv;
+    
+    size_t sizes[MAX_SWEEP_POINTS];
+    int num_sizes = generate_sweep(&ctx->latency_sweep, sizes, MAX_SWEEP_POINTS);
+    
+    char* buffer = arena_buffer(ctx, sizes[num_sizes - 1]);
+    if (!buffer) return;
+    
+    latency_histogram_t* hist = malloc(sizeof(latency_histogram_t));
+    if (!hist) return;
+    
+    double tsc_ghz = measure_tsc_ghz();
+    uint64_t overhead = measure_timer_overhead();
+    
+    if (csv) {
+        cachebench_printf(ctx, "record,size_bytes,samples,p50_cycles,p99_cycles,p999_cycles,max_cycles,bucket_low_cycles,bucket_high_cycles,count\n");
+    } else {
+        cachebench_printf(ctx, "=== Pointer-Chase Latency Histogram ===\n");
+        cachebench_printf(ctx, "%d samples of %d dependent load%s per size, %s preconditioning\n",
+                          samples, batch, batch == 1 ? "" : "s", precondition_names[mode]);
+        cachebench_printf(ctx, "TSC: %.3f GHz, timer overhead %llu cycles (subtracted)\n\n",
+                          tsc_ghz, (unsigned long long)overhead);
+    }
+    
+    for (int i = 0; i < num_sizes; i++) {
+        size_t size = sizes[i];
+        if (size < 2 * CACHE_LINE_SIZE) continue;
+        
+        void** start = build_pointer_chain(buffer, size);
+        if (!start) break;
+        
+        memset(hist, 0, sizeof(*hist));
+        precondition_buffer(ctx, buffer, size, mode);
+        // Only warm runs lap the chain first; a lap would undo cold, evict and dirty
+        sample_chase_latency(start, size / CACHE_LINE_SIZE, samples, batch, overhead,
+                             mode == PRECONDITION_WARM, hist);
+        
+        double p50 = histogram_percentile(hist, 50.0);
+        double p99 = histogram_percentile(hist, 99.0);
+        double p999 = histogram_percentile(hist, 99.9);
+        
+        if (csv) {
+            cachebench_printf(ctx, "summary,%zu,%llu,%.1f,%.1f,%.1f,%llu,,,\n", size,
+                              (unsigned long long)hist->total, p50, p99, p999,
+                              (unsigned long long)hist->max);
+            for (int b = 0; b < HIST_BUCKETS; b++) {
+                if (!hist->counts[b]) continue;
+                cachebench_printf(ctx, "bucket,%zu,,,,,,%llu,%llu,%llu\n", size,
+                                  (unsigned long long)histogram_bucket_low(b),
+                                  (unsigned long long)histogram_bucket_high(b),
+                                  (unsigned long long)hist->counts[b]);
+            }
+            continue;
+        }
+        
+        char label[32];
+        format_size(size, label, sizeof(label));
+        cachebench_printf(ctx, "%s: p50 %.1f ns (%.0f cyc), p99 %.1f ns (%.0f cyc), p99.9 %.1f ns (%.0f cyc), max %llu cyc\n",
+                          label, p50 / tsc_ghz, p50, p99 / tsc_ghz, p99, p999 / tsc_ghz, p999,
+                          (unsigned long long)hist->max);
+        print_histogram_ascii(ctx, hist, tsc_ghz);
+        cachebench_printf(ctx, "\n");
+    }
+    
+    free(hist);
+}
+
+const cachebench_test_t latency_test = {
+    "latency", "Sequential and random access cost across the working-set sweep",
+    "size=<latency sweep>,mode=<precondition>", "seq_ns, rand_ns",
+    TEST_IN_SUITE, run_latency_test
+};
+
+const cachebench_test_t stride_test = {
+    "stride", "Access cost by stride over a 1MB buffer",
+    "stride=1..512,mode=<precondition>", "ns",
+    TEST_IN_SUITE, run_stride_test
+};
+
+const cachebench_test_t thrashing_test = {
+    "thrashing", "Conflict misses from more lines per set than the cache has ways",
+    "level=L1|L2|L3,ways=<n>,mode=<precondition>", "ms",
+    TEST_IN_SUITE, run_cache_thrashing_test
+};
+
+const cachebench_test_t read_write_test = {
+    "readwrite", "Read versus write cost at each nominal cache size",
+    "size=L1|L2|L3|2xL3,mode=<precondition>", "read_ns, write_ns",
+    TEST_IN_SUITE, run_read_write_comparison
+};
+
+const cachebench_test_t l3_test = {
+    "l3", "Fine-grained sweep around the L3 boundary",
+    "size=<l3 sweep>,mode=<precondition>", "seq_ns, rand_ns",
+    TEST_IN_SUITE, run_detailed_l3_test
+};
+
+const cachebench_test_t histogram_test = {
+    "histogram", "Per-load pointer-chase latency histogram over the latency sweep",
+    "size=<latency sweep>,samples,batch", "p50/p99/p99.9/max cycles, buckets",
+    0, run_latency_histogram
+};
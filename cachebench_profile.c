@@ -0,0 +1,195 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+// Keeps chase results live so the loads are not optimized away
+static void* volatile profile_sink;
+
+// Average cost of one dependent load, in ns
+static double chase_ns(void** start, int loads) {
+    void** p = start;
+
+    double start_time = get_time_ms();
+    for (int i = 0; i < loads; i++) p = (void**)*p;
+    double end_time = get_time_ms();
+
+    profile_sink = p;
+    return (end_time - start_time) * 1e6 / loads;
+}
+
+// Sequential GB/s over size bytes, streaming about PROFILE_STREAM_BYTES
+static double stream_bandwidth(cachebench_context_t* ctx, char* buffer, size_t size) {
+    int iterations = (int)(PROFILE_STREAM_BYTES / size);
+    if (iterations < 1) iterations = 1;
+
+    precondition_buffer(ctx, buffer, size, PRECONDITION_WARM);
+    double ms = benchmark_sequential_access(buffer, size, iterations);
+    return (double)size * iterations / (ms / 1000.0) / (1024*1024*1024);
+}
+
+// Measured capacity of detected level index, capped at the reported size
+// (the nominal one when the OS reports none). Falls back to that size when
+// the sweep did not resolve the level.
+static size_t level_capacity(const cache_level_t* levels, int num_levels, int index,
+                             long reported, size_t nominal) {
+    size_t limit = reported > 0 ? (size_t)reported : nominal;
+    if (index >= num_levels - 1 || strcmp(levels[index].name, "DRAM") == 0) return limit;
+    return levels[index].capacity < limit ? levels[index].capacity : limit;
+}
+
+// Square tile edge, in doubles, such that three tiles (two inputs and the
+// output of a blocked kernel) fit in bytes; a multiple of one line of doubles
+static int tile_edge(size_t bytes) {
+    int per_line = CACHE_LINE_SIZE / sizeof(double);
+    int edge = (int)sqrt((double)bytes / (3 * sizeof(double)));
+    edge -= edge % per_line;
+    return edge > per_line ? edge : per_line;
+}
+
+// Measure what a service needs to size its data at startup: a pointer-chase
+// sweep from 4KB to twice the LLC (capped at PROFILE_MAX_SIZE), segmented
+// into levels like the full suite, plus one-thread sequential bandwidth at
+// L1d, L2 and the largest swept size. Returns -1 if the arena cannot grow.
+int cachebench_profile(cachebench_context_t* ctx, cachebench_profile_t* profile) {
+    double start_ms = get_time_ms();
+    memset(profile, 0, sizeof(*profile));
+
+    get_host_info(&profile->host);
+    profile->cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    profile->line_size = CACHE_LINE_SIZE;
+#ifdef _SC_LEVEL1_DCACHE_LINESIZE
+    long line_size = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+    if (line_size > 0) profile->line_size = line_size;
+#endif
+
+    long llc = profile->host.l3_size > 0 ? profile->host.l3_size : L3_CACHE_SIZE;
+    sweep_config_t sweep = {MIN_SIZE, (size_t)llc * 2, 2, 0};
+    if (sweep.max_size > PROFILE_MAX_SIZE) sweep.max_size = PROFILE_MAX_SIZE;
+
+    size_t sizes[MAX_SWEEP_POINTS];
+    int num_sizes = generate_sweep(&sweep, sizes, MAX_SWEEP_POINTS);
+
+    char* buffer = arena_buffer(ctx, sizes[num_sizes - 1]);
+    if (!buffer) return -1;
+
+    curve_point_t curve[MAX_SWEEP_POINTS];
+    for (int i = 0; i < num_sizes; i++) {
+        void** start = build_pointer_chain(buffer, sizes[i]);
+        if (!start) return -1;
+
+        precondition_buffer(ctx, buffer, sizes[i], PRECONDITION_WARM);
+        curve[i] = (curve_point_t){0};
+        curve[i].size = sizes[i];
+        curve[i].rand_ns = chase_ns(start, PROFILE_CHASE_LOADS);
+        curve[i].samples = 1;
+    }
+
+    cache_level_t levels[MAX_LEVELS];
+    int num_levels = detect_cache_levels(curve, num_sizes, levels);
+
+    profile->l1d_size = level_capacity(levels, num_levels, 0, profile->host.l1d_size, L1_CACHE_SIZE);
+    profile->l2_size = level_capacity(levels, num_levels, 1, profile->host.l2_size, L2_CACHE_SIZE);
+    profile->l3_size = level_capacity(levels, num_levels, 2, profile->host.l3_size, L3_CACHE_SIZE);
+
+    // Latency at each level: the chase cost at half its capacity
+    size_t probes[] = {profile->l1d_size / 2, profile->l2_size / 2, profile->l3_size / 2};
+    double* latencies[] = {&profile->l1d_latency_ns, &profile->l2_latency_ns, &profile->l3_latency_ns};
+    for (int l = 0; l < 3; l++) {
+        for (int i = 0; i < num_sizes && sizes[i] <= probes[l]; i++) {
+            *latencies[l] = curve[i].rand_ns;
+        }
+    }
+    profile->dram_latency_ns = curve[num_sizes - 1].rand_ns;
+
+    profile->l1d_bandwidth = stream_bandwidth(ctx, buffer, profile->l1d_size / 2);
+    profile->l2_bandwidth = stream_bandwidth(ctx, buffer, profile->l2_size / 2);
+    profile->dram_bandwidth = stream_bandwidth(ctx, buffer, sizes[num_sizes - 1]);
+
+    profile->l1_tile_bytes = profile->l1d_size / 2;
+    profile->l1_tile_doubles = tile_edge(profile->l1_tile_bytes);
+    profile->l2_tile_bytes = profile->l2_size / 2;
+    profile->l2_tile_doubles = tile_edge(profile->l2_tile_bytes);
+
+    profile->hot_set_max = profile->l3_size;
+    for (int m = num_levels - 2; m >= 0; m--) {
+        if (strcmp(levels[m].name, "DRAM") == 0) continue;
+        if (levels[m].capacity < profile->hot_set_max) profile->hot_set_max = levels[m].capacity;
+        break;
+    }
+
+    // Lines in flight needed to cover memory latency at streaming bandwidth
+    double bytes_in_flight = profile->dram_latency_ns * 1e-9 *
+                             profile->dram_bandwidth * (1024.0 * 1024 * 1024);
+    profile->prefetch_lines = (int)ceil(bytes_in_flight / CACHE_LINE_SIZE);
+    if (profile->prefetch_lines < 1) profile->prefetch_lines = 1;
+
+    profile->elapsed_ms = get_time_ms() - start_ms;
+    return 0;
+}
+
+static void emit_string(cachebench_context_t* ctx, int* first, const char* key, const char* value) {
+    if (ctx->profile.json) {
+        cachebench_printf(ctx, "%s\n  \"%s\": \"%s\"", *first ? "{" : ",", key, value);
+    } else {
+        cachebench_printf(ctx, "%s=%s\n", key, value);
+    }
+    *first = 0;
+}
+
+// Integers (sizes, counts) are printed in full, measurements to 6 digits
+static void emit_number(cachebench_context_t* ctx, int* first, const char* key, double value) {
+    char text[32];
+    if (value == floor(value) && fabs(value) < 1e15) snprintf(text, sizeof(text), "%.0f", value);
+    else snprintf(text, sizeof(text), "%.6g", value);
+
+    if (ctx->profile.json) {
+        cachebench_printf(ctx, "%s\n  \"%s\": %s", *first ? "{" : ",", key, text);
+    } else {
+        cachebench_printf(ctx, "%s=%s\n", key, text);
+    }
+    *first = 0;
+}
+
+static void run_profile(cachebench_context_t* ctx) {
+    cachebench_profile_t profile;
+    if (cachebench_profile(ctx, &profile) != 0) {
+        cachebench_printf(ctx, "Failed to allocate memory for profile\n");
+        return;
+    }
+
+    int first = 1;
+    if (!ctx->profile.json) cachebench_printf(ctx, "# cache_benchmark profile\n");
+    emit_number(ctx, &first, "version", RESULT_FORMAT_VERSION);
+    emit_string(ctx, &first, "host.fingerprint", profile.host.fingerprint);
+    emit_string(ctx, &first, "host.cpu", profile.host.cpu);
+    emit_number(ctx, &first, "cpus", profile.cpus);
+    emit_number(ctx, &first, "line_size", profile.line_size);
+    emit_number(ctx, &first, "l1d.size", profile.l1d_size);
+    emit_number(ctx, &first, "l1d.latency_ns", profile.l1d_latency_ns);
+    emit_number(ctx, &first, "l1d.bandwidth_gbps", profile.l1d_bandwidth);
+    emit_number(ctx, &first, "l2.size", profile.l2_size);
+    emit_number(ctx, &first, "l2.latency_ns", profile.l2_latency_ns);
+    emit_number(ctx, &first, "l2.bandwidth_gbps", profile.l2_bandwidth);
+    emit_number(ctx, &first, "l3.size", profile.l3_size);
+    emit_number(ctx, &first, "l3.latency_ns", profile.l3_latency_ns);
+    emit_number(ctx, &first, "dram.latency_ns", profile.dram_latency_ns);
+    emit_number(ctx, &first, "dram.bandwidth_gbps", profile.dram_bandwidth);
+    emit_number(ctx, &first, "tile.l1_bytes", profile.l1_tile_bytes);
+    emit_number(ctx, &first, "tile.l1_doubles", profile.l1_tile_doubles);
+    emit_number(ctx, &first, "tile.l2_bytes", profile.l2_tile_bytes);
+    emit_number(ctx, &first, "tile.l2_doubles", profile.l2_tile_doubles);
+    emit_number(ctx, &first, "hot_set_max_bytes", profile.hot_set_max);
+    emit_number(ctx, &first, "prefetch_distance_lines", profile.prefetch_lines);
+    emit_number(ctx, &first, "prefetch_distance_bytes", (double)profile.prefetch_lines * CACHE_LINE_SIZE);
+    emit_number(ctx, &first, "profile_ms", profile.elapsed_ms);
+    if (ctx->profile.json) cachebench_printf(ctx, "\n}\n");
+}
+
+const cachebench_test_t profile_test = {
+    "profile", "Fast startup profile: recommended tile sizes, hot-set limit and prefetch distance",
+    "sweep=4K..min(2xLLC,64M)", "key=value or JSON profile",
+    0, run_profile
+};
@@ -0,0 +1,403 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+
+#define QUEUE_DEPTH 1024               // Slots per ring, a power of two
+#define QUEUE_MIN_PAYLOAD 8
+#define QUEUE_MAX_PAYLOAD 256
+#define QUEUE_MESSAGES (256 * 1024)    // Messages per throughput sample
+#define QUEUE_ROUND_TRIPS 4096         // Ping-pongs per latency sample
+
+typedef enum {
+    QUEUE_SPSC,                        // Reads the other side's index on every operation
+    QUEUE_SPSC_CACHED,                 // Re-reads it only when the ring looks full or empty
+    QUEUE_MPMC,                        // Vyukov's bounded MPMC, a sequence number per cell
+    QUEUE_MUTEX,                       // Ring under a pthread_mutex
+    NUM_QUEUES
+} queue_kind_t;
+
+static const char* queue_names[NUM_QUEUES] = {"spsc", "spsc-cached", "mpmc", "mutex"};
+
+typedef struct {
+    queue_kind_t kind;
+    size_t payload;
+    size_t stride;                     // Bytes per slot: payload, plus a sequence for MPMC
+    char* slots;
+    pthread_mutex_t mutex;
+
+    // Consumer side
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t head;
+    size_t cached_tail;
+
+    // Producer side
+    _Alignas(CACHE_LINE_SIZE) _Atomic size_t tail;
+    size_t cached_head;
+} ring_t;
+
+static int ring_init(ring_t* q, queue_kind_t kind, size_t payload) {
+    memset(q, 0, sizeof(*q));
+    q->kind = kind;
+    q->payload = payload;
+    q->stride = kind == QUEUE_MPMC ? payload + sizeof(size_t) : payload;
+    q->slots = aligned_alloc(CACHE_LINE_SIZE, QUEUE_DEPTH * q->stride);
+    if (!q->slots) return -1;
+    pthread_mutex_init(&q->mutex, NULL);
+
+    if (kind == QUEUE_MPMC) {
+        for (size_t i = 0; i < QUEUE_DEPTH; i++) {
+            atomic_init((_Atomic size_t*)(q->slots + i * q->stride), i);
+        }
+    }
+    return 0;
+}
+
+static void ring_destroy(ring_t* q) {
+    pthread_mutex_destroy(&q->mutex);
+    free(q->slots);
+}
+
+static inline char* slot_at(ring_t* q, size_t pos) {
+    return q->slots + (pos & (QUEUE_DEPTH - 1)) * q->stride;
+}
+
+static int try_push(ring_t* q, const void* msg) {
+    switch (q->kind) {
+    case QUEUE_SPSC:
+    case QUEUE_SPSC_CACHED: {
+        size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        if (q->kind == QUEUE_SPSC || tail - q->cached_head == QUEUE_DEPTH) {
+            q->cached_head = atomic_load_explicit(&q->head, memory_order_acquire);
+            if (tail - q->cached_head == QUEUE_DEPTH) return 0;
+        }
+        memcpy(slot_at(q, tail), msg, q->payload);
+        atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+        return 1;
+    }
+    case QUEUE_MPMC: {
+        size_t pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        for (;;) {
+            _Atomic size_t* seq = (_Atomic size_t*)slot_at(q, pos);
+            intptr_t diff = (intptr_t)atomic_load_explicit(seq, memory_order_acquire) - (intptr_t)pos;
+            if (diff == 0) {
+                if (atomic_compare_exchange_weak_explicit(&q->tail, &pos, pos + 1,
+                                                          memory_order_relaxed, memory_order_relaxed)) {
+                    memcpy((char*)seq + sizeof(size_t), msg, q->payload);
+                    atomic_store_explicit(seq, pos + 1, memory_order_release);
+                    return 1;
+                }
+            } else if (diff < 0) {
+                return 0;
+            } else {
+                pos = atomic_load_explicit(&q->tail, memory_order_relaxed);
+            }
+        }
+    }
+    default: {
+        pthread_mutex_lock(&q->mutex);
+        size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+        int ok = tail - atomic_load_explicit(&q->head, memory_order_relaxed) < QUEUE_DEPTH;
+        if (ok) {
+            memcpy(slot_at(q, tail), msg, q->payload);
+            atomic_store_explicit(&q->tail, tail + 1, memory_order_relaxed);
+        }
+        pthread_mutex_unlock(&q->mutex);
+        return ok;
+    }
+    }
+}
+
+static int try_pop(ring_t* q, void* msg) {
+    switch (q->kind) {
+    case QUEUE_SPSC:
+    case QUEUE_SPSC_CACHED: {
+        size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+        if (q->kind == QUEUE_SPSC || head == q->cached_tail) {
+            q->cached_tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+            if (head == q->cached_tail) return 0;
+        }
+        memcpy(msg, slot_at(q, head), q->payload);
+        atomic_store_explicit(&q->head, head + 1, memory_order_release);
+        return 1;
+    }
+    case QUEUE_MPMC: {
+        size_t pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+        for (;;) {
+            _Atomic size_t* seq = (_Atomic size_t*)slot_at(q, pos);
+            intptr_t diff = (intptr_t)atomic_load_explicit(seq, memory_order_acquire) - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (atomic_compare_exchange_weak_explicit(&q->head, &pos, pos + 1,
+                                                          memory_order_relaxed, memory_order_relaxed)) {
+                    memcpy(msg, (char*)seq + sizeof(size_t), q->payload);
+                    atomic_store_explicit(seq, pos + QUEUE_DEPTH, memory_order_release);
+                    return 1;
+                }
+            } else if (diff < 0) {
+                return 0;
+            } else {
+                pos = atomic_load_explicit(&q->head, memory_order_relaxed);
+            }
+        }
+    }
+    default: {
+        pthread_mutex_lock(&q->mutex);
+        size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+        int ok = head != atomic_load_explicit(&q->tail, memory_order_relaxed);
+        if (ok) {
+            memcpy(msg, slot_at(q, head), q->payload);
+            atomic_store_explicit(&q->head, head + 1, memory_order_relaxed);
+        }
+        pthread_mutex_unlock(&q->mutex);
+        return ok;
+    }
+    }
+}
+
+static void push(ring_t* q, const void* msg) {
+    int spins = 0;
+    while (!try_push(q, msg)) spin_wait(&spins);
+}
+
+static void pop(ring_t* q, void* msg) {
+    int spins = 0;
+    while (!try_pop(q, msg)) spin_wait(&spins);
+}
+
+typedef struct {
+    ring_t* forward;
+    ring_t* back;                      // Latency runs echo every message back
+    size_t messages;                   // Sent, received or echoed by this thread
+    int cpu;
+    _Atomic int* go;                   // 1 to start, -1 when the run is abandoned
+    uint64_t sum;
+    double ms;                         // Ping side of a latency run
+} queue_worker_t;
+
+static int worker_start(queue_worker_t* w) {
+    pin_thread(w->cpu);
+    int go;
+    while (!(go = atomic_load_explicit(w->go, memory_order_acquire))) sched_yield();
+    return go > 0;
+}
+
+static void* producer_thread(void* arg) {
+    queue_worker_t* w = arg;
+    uint64_t msg[QUEUE_MAX_PAYLOAD / sizeof(uint64_t)] = {0};
+    if (!worker_start(w)) return NULL;
+    for (size_t i = 0; i < w->messages; i++) {
+        msg[0] = i;
+        push(w->forward, msg);
+    }
+    return NULL;
+}
+
+static void* consumer_thread(void* arg) {
+    queue_worker_t* w = arg;
+    uint64_t msg[QUEUE_MAX_PAYLOAD / sizeof(uint64_t)];
+    if (!worker_start(w)) return NULL;
+    for (size_t i = 0; i < w->messages; i++) {
+        pop(w->forward, msg);
+        w->sum += msg[0];
+    }
+    return NULL;
+}
+
+static void* echo_thread(void* arg) {
+    queue_worker_t* w = arg;
+    uint64_t msg[QUEUE_MAX_PAYLOAD / sizeof(uint64_t)];
+    if (!worker_start(w)) return NULL;
+    for (size_t i = 0; i < w->messages; i++) {
+        pop(w->forward, msg);
+        push(w->back, msg);
+    }
+    return NULL;
+}
+
+static void* ping_thread(void* arg) {
+    queue_worker_t* w = arg;
+    uint64_t msg[QUEUE_MAX_PAYLOAD / sizeof(uint64_t)] = {0};
+    if (!worker_start(w)) return NULL;
+
+    double start_time = get_time_ms();
+    for (size_t i = 0; i < w->messages; i++) {
+        msg[0] = i;
+        push(w->forward, msg);
+        pop(w->back, msg);
+        w->sum += msg[0];
+    }
+    w->ms = get_time_ms() - start_time;
+    return NULL;
+}
+
+// Start one thread per worker and run them to completion. Returns the
+// elapsed ms, or -1 when a thread could not be created (none then runs).
+static double run_workers(queue_worker_t* workers, void* (**bodies)(void*), int count) {
+    _Atomic int go;
+    atomic_init(&go, 0);
+    pthread_t threads[MAX_CPUS];
+
+    int created = 0;
+    for (; created < count; created++) {
+        workers[created].go = &go;
+        if (pthread_create(&threads[created], NULL, bodies[created], &workers[created]) != 0) break;
+    }
+
+    double start_time = get_time_ms();
+    atomic_store_explicit(&go, created == count ? 1 : -1, memory_order_release);
+    for (int t = 0; t < created; t++) pthread_join(threads[t], NULL);
+    double ms = get_time_ms() - start_time;
+    return created == count ? ms : -1;
+}
+
+// Messages per second from producers to one consumer, each producer sending
+// QUEUE_MESSAGES / producers. cpus[0] is the consumer. Returns -1 on failure.
+static double time_throughput(queue_kind_t kind, size_t payload, const int* cpus, int producers) {
+    ring_t q;
+    if (ring_init(&q, kind, payload) != 0) return -1;
+
+    size_t per_producer = QUEUE_MESSAGES / producers;
+    queue_worker_t workers[MAX_CPUS];
+    void* (*bodies[MAX_CPUS])(void*);
+    for (int t = 0; t <= producers; t++) {
+        workers[t] = (queue_worker_t){&q, NULL, t == 0 ? per_producer * producers : per_producer,
+                                      cpus[t], NULL, 0, 0};
+        bodies[t] = t == 0 ? consumer_thread : producer_thread;
+    }
+
+    double ms = run_workers(workers, bodies, producers + 1);
+    ring_destroy(&q);
+
+    uint64_t expected = (uint64_t)producers * per_producer * (per_producer - 1) / 2;
+    if (ms <= 0 || workers[0].sum != expected) return -1;
+    return per_producer * producers / (ms / 1000.0);
+}
+
+// One-way latency in ns: half a ping-pong round trip between cpus[0] and
+// cpus[1]. Returns -1 on failure.
+static double time_latency(queue_kind_t kind, size_t payload, const int* cpus) {
+    ring_t forward, back;
+    if (ring_init(&forward, kind, payload) != 0) return -1;
+    if (ring_init(&back, kind, payload) != 0) {
+        ring_destroy(&forward);
+        return -1;
+    }
+
+    queue_worker_t workers[2] = {
+        {&forward, &back, QUEUE_ROUND_TRIPS, cpus[0], NULL, 0, 0},
+        {&forward, &back, QUEUE_ROUND_TRIPS, cpus[1], NULL, 0, 0},
+    };
+    void* (*bodies[2])(void*) = {ping_thread, echo_thread};
+    double ms = run_workers(workers, bodies, 2);
+    ring_destroy(&forward);
+    ring_destroy(&back);
+
+    uint64_t expected = (uint64_t)QUEUE_ROUND_TRIPS * (QUEUE_ROUND_TRIPS - 1) / 2;
+    if (ms <= 0 || workers[0].sum != expected) return -1;
+    return workers[0].ms * 1e6 / QUEUE_ROUND_TRIPS / 2;
+}
+
+static void run_queue_row(cachebench_context_t* ctx, placement_t placement, const int* cpus,
+                          size_t payload) {
+    double mmsgs[NUM_QUEUES], latency[NUM_QUEUES];
+
+    for (int k = 0; k < NUM_QUEUES; k++) {
+        double rate_samples[RESULT_SAMPLES], latency_samples[RESULT_SAMPLES];
+        mmsgs[k] = latency[k] = 0;
+        for (int s = 0; s < RESULT_SAMPLES && mmsgs[k] >= 0; s++) {
+            double rate = time_throughput(k, payload, cpus, 1);
+            double ns = time_latency(k, payload, cpus);
+            if (rate <= 0 || ns <= 0) {
+                mmsgs[k] = -1;
+                break;
+            }
+            rate_samples[s] = 1e9 / rate;
+            latency_samples[s] = ns;
+            mmsgs[k] += rate / 1e6 / RESULT_SAMPLES;
+            latency[k] += ns / RESULT_SAMPLES;
+        }
+        if (mmsgs[k] < 0) continue;
+
+        char params[64];
+        snprintf(params, sizeof(params), "queue=%s,payload=%zu,placement=%s",
+                 queue_names[k], payload, placement_names[placement]);
+        record_result(&ctx->results, "queue", params, "msg_ns", rate_samples, RESULT_SAMPLES);
+        record_result(&ctx->results, "queue", params, "latency_ns", latency_samples, RESULT_SAMPLES);
+    }
+
+    cachebench_printf(ctx, "%-12s\t%zu B", placement_names[placement], payload);
+    for (int k = 0; k < NUM_QUEUES; k++) {
+        if (mmsgs[k] < 0) cachebench_printf(ctx, "\tn/a");
+        else cachebench_printf(ctx, "\t%.2f", mmsgs[k]);
+    }
+    for (int k = 0; k < NUM_QUEUES; k++) {
+        if (mmsgs[k] < 0) cachebench_printf(ctx, "\tn/a");
+        else cachebench_printf(ctx, "\t%.0f", latency[k]);
+    }
+    cachebench_printf(ctx, "\n");
+}
+
+static void run_queue_test(cachebench_context_t* ctx) {
+    cpu_topology_t topo;
+    get_cpu_topology(&topo);
+    int max_threads = worker_threads(ctx);
+    if (max_threads > MAX_CPUS) max_threads = MAX_CPUS;
+
+    cachebench_printf(ctx, "=== Lock-Free Queues ===\n");
+    cachebench_printf(ctx, "%d-slot rings, %d messages per throughput sample, %d round trips "
+                      "per latency sample\n", QUEUE_DEPTH, QUEUE_MESSAGES, QUEUE_ROUND_TRIPS);
+    cachebench_printf(ctx, "One producer and one consumer: Mmsg/s, then one-way latency in ns "
+                      "(half a ping-pong)\n");
+    cachebench_printf(ctx, "Placement\tPayload");
+    for (int k = 0; k < NUM_QUEUES; k++) cachebench_printf(ctx, "\t%s", queue_names[k]);
+    for (int k = 0; k < NUM_QUEUES; k++) cachebench_printf(ctx, "\t%s", queue_names[k]);
+    cachebench_printf(ctx, "\n");
+    cachebench_printf(ctx, "--------------------------------------------------------------------------------------------------------------\n");
+
+    int cpus[MAX_CPUS];
+    for (int placement = 0; placement < NUM_PLACEMENTS; placement++) {
+        if (place_threads(&topo, placement, 2, cpus) != 0) continue;
+        for (size_t payload = QUEUE_MIN_PAYLOAD; payload <= QUEUE_MAX_PAYLOAD; payload *= 2) {
+            run_queue_row(ctx, placement, cpus, payload);
+        }
+    }
+
+    // Fan-in: every other thread produces into one consumer
+    int producers = max_threads - 1;
+    if (producers >= 2 && place_threads(&topo, PLACEMENT_ANY, producers + 1, cpus) == 0) {
+        cachebench_printf(ctx, "\nFan-in: %d producers, one consumer, Mmsg/s\n", producers);
+        cachebench_printf(ctx, "Payload\t\t%s\t%s\n", queue_names[QUEUE_MPMC], queue_names[QUEUE_MUTEX]);
+        for (size_t payload = QUEUE_MIN_PAYLOAD; payload <= QUEUE_MAX_PAYLOAD; payload *= 4) {
+            cachebench_printf(ctx, "%zu B\t", payload);
+            for (int k = QUEUE_MPMC; k <= QUEUE_MUTEX; k++) {
+                double samples[RESULT_SAMPLES], mmsgs = 0;
+                int ok = 1;
+                for (int s = 0; s < RESULT_SAMPLES && ok; s++) {
+                    double rate = time_throughput(k, payload, cpus, producers);
+                    ok = rate > 0;
+                    samples[s] = ok ? 1e9 / rate : 0;
+                    mmsgs += rate / 1e6 / RESULT_SAMPLES;
+                }
+                if (!ok) {
+                    cachebench_printf(ctx, "\tn/a");
+                    continue;
+                }
+                char params[64];
+                snprintf(params, sizeof(params), "queue=%s,payload=%zu,producers=%d",
+                         queue_names[k], payload, producers);
+                record_result(&ctx->results, "queue", params, "msg_ns", samples, RESULT_SAMPLES);
+                cachebench_printf(ctx, "\t%.2f", mmsgs);
+            }
+            cachebench_printf(ctx, "\n");
+        }
+    }
+    cachebench_printf(ctx, "\n");
+}
+
+const cachebench_test_t queue_test = {
+    "queue", "SPSC (plain and cached indices), Vyukov MPMC and mutex rings across placements",
+    "queue=spsc|spsc-cached|mpmc|mutex,payload=8..256,placement", "msg_ns, latency_ns",
+    0, run_queue_test
+};
@@ -0,0 +1,620 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <cpuid.h>
+#include <errno.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#endif
+
+// Add a sequential/random measurement to the latency-vs-size curve.
+// Repeated sizes are averaged so overlapping tests refine the same point.
+void record_curve_point(cachebench_context_t* ctx, size_t size, double seq_ms, double rand_ms, int iterations) {
+    double seq_accesses = (double)iterations * (size / CACHE_LINE_SIZE);
+    double rand_accesses = (double)iterations * (size / sizeof(size_t));
+    double seq_ns = seq_ms * 1e6 / seq_accesses;
+    double rand_ns = rand_ms * 1e6 / rand_accesses;
+    double bandwidth = (double)size * iterations / (seq_ms / 1000.0) / (1024*1024*1024);
+
+    int pos = 0;
+    while (pos < ctx->num_points && ctx->curve[pos].size < size) pos++;
+
+    if (pos < ctx->num_points && ctx->curve[pos].size == size) {
+        curve_point_t* p = &ctx->curve[pos];
+        int n = p->samples;
+        p->seq_ms = (p->seq_ms * n + seq_ms) / (n + 1);
+        p->rand_ms = (p->rand_ms * n + rand_ms) / (n + 1);
+        p->seq_ns = (p->seq_ns * n + seq_ns) / (n + 1);
+        p->rand_ns = (p->rand_ns * n + rand_ns) / (n + 1);
+        p->bandwidth = (p->bandwidth * n + bandwidth) / (n + 1);
+        p->samples = n + 1;
+        return;
+    }
+
+    if (ctx->num_points >= MAX_CURVE_POINTS) return;
+
+    memmove(&ctx->curve[pos + 1], &ctx->curve[pos],
+            (ctx->num_points - pos) * sizeof(curve_point_t));
+    ctx->curve[pos] = (curve_point_t){size, seq_ms, rand_ms, seq_ns, rand_ns, bandwidth, 1};
+    ctx->num_points++;
+}
+
+void record_result(result_set_t* set, const char* test, const char* params,
+                   const char* metric, const double* samples, int num_samples) {
+    if (set->num_rows == set->capacity) {
+        int capacity = set->capacity ? set->capacity * 2 : 64;
+        result_row_t* rows = realloc(set->rows, capacity * sizeof(result_row_t));
+        if (!rows) return;
+        set->rows = rows;
+        set->capacity = capacity;
+    }
+    
+    result_row_t* row = &set->rows[set->num_rows++];
+    snprintf(row->test, sizeof(row->test), "%s", test);
+    snprintf(row->params, sizeof(row->params), "%s", params);
+    snprintf(row->metric, sizeof(row->metric), "%s", metric);
+    if (num_samples > RESULT_SAMPLES) num_samples = RESULT_SAMPLES;
+    memcpy(row->samples, samples, num_samples * sizeof(double));
+    row->num_samples = num_samples;
+}
+
+void free_results(result_set_t* set) {
+    free(set->rows);
+    set->rows = NULL;
+    set->num_rows = 0;
+    set->capacity = 0;
+}
+
+static void read_text_file(const char* path, char* out, size_t len) {
+    out[0] = '\0';
+    FILE* f = fopen(path, "r");
+    if (!f) return;
+    if (fgets(out, (int)len, f)) out[strcspn(out, "\n")] = '\0';
+    fclose(f);
+}
+
+// Cache size in bytes from sysfs ("48K"), for libcs without _SC_LEVEL*
+static long sysfs_cache_size(int index) {
+    char path[96], text[32];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%d/size", index);
+    read_text_file(path, text, sizeof(text));
+    size_t size;
+    return parse_size(text, &size) == 0 ? (long)size : 0;
+}
+
+// Identify the host: CPU brand, microcode, kernel and the cache sizes the OS
+// reports. Runs are only directly comparable with the same fingerprint.
+void get_host_info(host_info_t* host) {
+    memset(host, 0, sizeof(*host));
+    
+    unsigned int brand[12];
+    if (__get_cpuid(0x80000002, &brand[0], &brand[1], &brand[2], &brand[3]) &&
+        __get_cpuid(0x80000003, &brand[4], &brand[5], &brand[6], &brand[7]) &&
+        __get_cpuid(0x80000004, &brand[8], &brand[9], &brand[10], &brand[11])) {
+        char text[49];
+        memcpy(text, brand, 48);
+        text[48] = '\0';
+        char* start = text;
+        while (*start == ' ') start++;
+        snprintf(host->cpu, sizeof(host->cpu), "%s", start);
+    } else {
+        snprintf(host->cpu, sizeof(host->cpu), "unknown");
+    }
+    
+    snprintf(host->microcode, sizeof(host->microcode), "unknown");
+    FILE* cpuinfo = fopen("/proc/cpuinfo", "r");
+    if (cpuinfo) {
+        char line[256];
+        while (fgets(line, sizeof(line), cpuinfo)) {
+            if (strncmp(line, "microcode", 9) == 0) {
+                char* colon = strchr(line, ':');
+                if (colon) {
+                    colon++;
+                    while (*colon == ' ') colon++;
+                    colon[strcspn(colon, "\n")] = '\0';
+                    snprintf(host->microcode, sizeof(host->microcode), "%s", colon);
+                }
+                break;
+            }
+        }
+        fclose(cpuinfo);
+    }
+    
+#ifdef _WIN32
+    snprintf(host->kernel, sizeof(host->kernel), "windows");
+#else
+    struct utsname name;
+    if (uname(&name) == 0) {
+        snprintf(host->kernel, sizeof(host->kernel), "%s %s", name.sysname, name.release);
+    }
+#endif
+    
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    host->l1d_size = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+    host->l2_size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    host->l3_size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+#endif
+    if (host->l1d_size <= 0) host->l1d_size = sysfs_cache_size(0);
+    if (host->l2_size <= 0) host->l2_size = sysfs_cache_size(2);
+    if (host->l3_size <= 0) host->l3_size = sysfs_cache_size(3);
+    
+    char key[512];
+    snprintf(key, sizeof(key), "%s|%s|%s|%ld|%ld|%ld", host->cpu, host->microcode,
+             host->kernel, host->l1d_size, host->l2_size, host->l3_size);
+    uint64_t hash = 14695981039346656037ull;
+    for (const char* c = key; *c; c++) {
+        hash ^= (unsigned char)*c;
+        hash *= 1099511628211ull;
+    }
+    snprintf(host->fingerprint, sizeof(host->fingerprint), "%016llx", (unsigned long long)hash);
+}
+
+// Write the run to DIR/<fingerprint>-<timestamp>.txt and return that path
+int save_results(const result_set_t* set, const char* dir, char* path, size_t path_len) {
+#ifdef _WIN32
+    _mkdir(dir);
+#else
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) return -1;
+#endif
+    
+    snprintf(path, path_len, "%s/%s-%s.txt", dir, set->host.fingerprint, set->timestamp);
+    FILE* f = fopen(path, "w");
+    if (!f) return -1;
+    
+    fprintf(f, "# cache_benchmark results\n");
+    fprintf(f, "version=%d\n", RESULT_FORMAT_VERSION);
+    fprintf(f, "timestamp=%s\n", set->timestamp);
+    fprintf(f, "host.fingerprint=%s\n", set->host.fingerprint);
+    fprintf(f, "host.cpu=%s\n", set->host.cpu);
+    fprintf(f, "host.microcode=%s\n", set->host.microcode);
+    fprintf(f, "host.kernel=%s\n", set->host.kernel);
+    fprintf(f, "host.l1d=%ld\n", set->host.l1d_size);
+    fprintf(f, "host.l2=%ld\n", set->host.l2_size);
+    fprintf(f, "host.l3=%ld\n", set->host.l3_size);
+    
+    for (int i = 0; i < set->num_rows; i++) {
+        const result_row_t* row = &set->rows[i];
+        fprintf(f, "result\t%s\t%s\t%s\t", row->test, row->params, row->metric);
+        for (int j = 0; j < row->num_samples; j++) {
+            fprintf(f, "%s%.6g", j ? " " : "", row->samples[j]);
+        }
+        fprintf(f, "\n");
+    }
+    
+    fclose(f);
+    return 0;
+}
+
+int load_results(const char* path, result_set_t* set) {
+    FILE* f = fopen(path, "r");
+    if (!f) return -1;
+    
+    memset(set, 0, sizeof(*set));
+    char line[1024];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        line[strcspn(line, "\n")] = '\0';
+        if (line[0] == '#' || line[0] == '\0') continue;
+        
+        if (strncmp(line, "result\t", 7) == 0) {
+            // test, params, metric and samples; skip truncated rows
+            char* fields[4];
+            int num_fields = 0;
+            char* cursor = line + 7;
+            while (num_fields < 4) {
+                fields[num_fields++] = cursor;
+                char* tab = strchr(cursor, '\t');
+                if (!tab) break;
+                *tab = '\0';
+                cursor = tab + 1;
+            }
+            
+            double samples[RESULT_SAMPLES];
+            int n = 0;
+            if (num_fields == 4) {
+                for (char* v = strtok(fields[3], " "); v && n < RESULT_SAMPLES; v = strtok(NULL, " ")) {
+                    samples[n++] = strtod(v, NULL);
+                }
+            }
+            if (n == 0) {
+                fprintf(stderr, "%s:%d: malformed result line skipped\n", path, line_no);
+                continue;
+            }
+            record_result(set, fields[0], fields[1], fields[2], samples, n);
+            continue;
+        }
+        
+        char* eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = '\0';
+        const char* value = eq + 1;
+        
+        // Refuse files written in another format rather than misread them
+        if (strcmp(line, "version") == 0 && atoi(value) != RESULT_FORMAT_VERSION) {
+            fprintf(stderr, "%s: result format version %s, expected %d\n", path, value,
+                    RESULT_FORMAT_VERSION);
+            fclose(f);
+            free_results(set);
+            return -1;
+        }
+        
+        if (strcmp(line, "timestamp") == 0) snprintf(set->timestamp, sizeof(set->timestamp), "%s", value);
+        else if (strcmp(line, "host.fingerprint") == 0) snprintf(set->host.fingerprint, sizeof(set->host.fingerprint), "%s", value);
+        else if (strcmp(line, "host.cpu") == 0) snprintf(set->host.cpu, sizeof(set->host.cpu), "%s", value);
+        else if (strcmp(line, "host.microcode") == 0) snprintf(set->host.microcode, sizeof(set->host.microcode), "%s", value);
+        else if (strcmp(line, "host.kernel") == 0) snprintf(set->host.kernel, sizeof(set->host.kernel), "%s", value);
+        else if (strcmp(line, "host.l1d") == 0) set->host.l1d_size = atol(value);
+        else if (strcmp(line, "host.l2") == 0) set->host.l2_size = atol(value);
+        else if (strcmp(line, "host.l3") == 0) set->host.l3_size = atol(value);
+    }
+    
+    fclose(f);
+    return 0;
+}
+
+
+static double segment_cost(const double* sum, const double* sum_sq, int from, int to) {
+    int n = to - from;
+    double s = sum[to] - sum[from];
+    double sq = sum_sq[to] - sum_sq[from];
+    return sq - s * s / n;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double median_of(double* values, int n) {
+    qsort(values, n, sizeof(double), compare_doubles);
+    return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2.0;
+}
+
+// Fit the latency-vs-size curve with piecewise-constant segments on
+// log2(latency) and return the detected levels. The segmentation for each
+// level count is optimal in the least-squares sense (dynamic programming);
+// the largest count whose steps clear both LEVEL_STEP_RATIO and the noise
+// floor of the fit is kept.
+int detect_cache_levels(const curve_point_t* curve, int n, cache_level_t* levels) {
+    if (n == 0) return 0;
+
+    double y[MAX_CURVE_POINTS];
+    double sum[MAX_CURVE_POINTS + 1] = {0}, sum_sq[MAX_CURVE_POINTS + 1] = {0};
+    for (int i = 0; i < n; i++) {
+        y[i] = log2(curve[i].rand_ns > 0 ? curve[i].rand_ns : 1e-9);
+        sum[i + 1] = sum[i] + y[i];
+        sum_sq[i + 1] = sum_sq[i] + y[i] * y[i];
+    }
+
+    // cost[k][j]: best SSE of the first j points split into k segments
+    double cost[MAX_LEVELS + 1][MAX_CURVE_POINTS + 1];
+    int split[MAX_LEVELS + 1][MAX_CURVE_POINTS + 1];
+    for (int k = 0; k <= MAX_LEVELS; k++)
+        for (int j = 0; j <= n; j++) cost[k][j] = DBL_MAX;
+    cost[0][0] = 0;
+
+    for (int k = 1; k <= MAX_LEVELS; k++) {
+        for (int j = k; j <= n; j++) {
+            for (int i = k - 1; i < j; i++) {
+                double c = cost[k - 1][i] + segment_cost(sum, sum_sq, i, j);
+                if (c < cost[k][j]) {
+                    cost[k][j] = c;
+                    split[k][j] = i;
+                }
+            }
+        }
+    }
+
+    int max_k = n < MAX_LEVELS ? n : MAX_LEVELS;
+    int bounds[MAX_LEVELS + 1];
+    int best_k = 1;
+
+    for (int k = max_k; k > 1; k--) {
+        bounds[k] = n;
+        for (int m = k; m > 0; m--) bounds[m - 1] = split[m][bounds[m]];
+
+        double noise = sqrt(cost[k][n] / n);
+        int valid = 1;
+        for (int m = 1; m < k; m++) {
+            double left = (sum[bounds[m]] - sum[bounds[m - 1]]) / (bounds[m] - bounds[m - 1]);
+            double right = (sum[bounds[m + 1]] - sum[bounds[m]]) / (bounds[m + 1] - bounds[m]);
+            double step = right - left;
+            if (step < log2(LEVEL_STEP_RATIO) || step < 3.0 * noise) {
+                valid = 0;
+                break;
+            }
+        }
+        if (valid) {
+            best_k = k;
+            break;
+        }
+    }
+
+    bounds[best_k] = n;
+    for (int m = best_k; m > 0; m--) bounds[m - 1] = split[m][bounds[m]];
+
+    for (int m = 0; m < best_k; m++) {
+        int from = bounds[m], to = bounds[m + 1];
+        double lat[MAX_CURVE_POINTS], bw[MAX_CURVE_POINTS];
+        for (int i = from; i < to; i++) {
+            lat[i - from] = curve[i].rand_ns;
+            bw[i - from] = curve[i].bandwidth;
+        }
+
+        cache_level_t* level = &levels[m];
+        level->first_size = curve[from].size;
+        level->capacity = curve[to - 1].size;
+        level->latency_ns = median_of(lat, to - from);
+        level->bandwidth = median_of(bw, to - from);
+
+        // The outermost segment is DRAM once the sweep has gone past the nominal LLC
+        if (m == best_k - 1 && m > 0 && level->first_size > L3_CACHE_SIZE) {
+            snprintf(level->name, sizeof(level->name), "DRAM");
+        } else if (m == MAX_LEVELS - 1) {
+            snprintf(level->name, sizeof(level->name), "DRAM");
+        } else {
+            snprintf(level->name, sizeof(level->name), "L%d", m + 1);
+        }
+    }
+
+    return best_k;
+}
+
+// Cache capacities for sizing workloads: the levels detected from this
+// context's latency curve when one was measured, OS-reported (or nominal)
+// sizes otherwise. Returns the number of levels, DRAM excluded.
+int get_cache_limits(cachebench_context_t* ctx, level_limit_t* limits, const char** source) {
+    int count = 0;
+
+    if (ctx->num_points > 0) {
+        cache_level_t levels[MAX_LEVELS];
+        int num_levels = detect_cache_levels(ctx->curve, ctx->num_points, levels);
+        for (int m = 0; m < num_levels - 1; m++) {
+            if (strcmp(levels[m].name, "DRAM") == 0) break;
+            memcpy(limits[count].name, levels[m].name, sizeof(limits[count].name));
+            limits[count++].capacity = levels[m].capacity;
+        }
+        if (count > 0) {
+            *source = "detected";
+            return count;
+        }
+    }
+
+    host_info_t host;
+    get_host_info(&host);
+    long reported[] = {host.l1d_size, host.l2_size, host.l3_size};
+    size_t nominal[] = {L1_CACHE_SIZE, L2_CACHE_SIZE, L3_CACHE_SIZE};
+    for (int l = 0; l < 3; l++) {
+        snprintf(limits[count].name, sizeof(limits[count].name), "L%d", l + 1);
+        limits[count++].capacity = reported[l] > 0 ? (size_t)reported[l] : nominal[l];
+    }
+    *source = host.l1d_size > 0 ? "OS-reported" : "nominal";
+    return count;
+}
+
+void analyze_results(cachebench_context_t* ctx) {
+    cachebench_printf(ctx, "=== Performance Analysis ===\n");
+
+    cache_level_t levels[MAX_LEVELS];
+    int num_levels = detect_cache_levels(ctx->curve, ctx->num_points, levels);
+    if (num_levels == 0) {
+        cachebench_printf(ctx, "No latency measurements to analyze\n");
+        cachebench_printf(ctx, "================================\n");
+        return;
+    }
+
+    cachebench_printf(ctx, "Detected from this run (%d working-set sizes):\n\n", ctx->num_points);
+    cachebench_printf(ctx, "Level\tCapacity\tRandom (ns/access)\tBandwidth (GB/s)\tvs Previous\n");
+    cachebench_printf(ctx, "------------------------------------------------------------------------\n");
+
+    for (int i = 0; i < num_levels; i++) {
+        char capacity[32];
+        if (i == num_levels - 1 && levels[i].capacity == ctx->curve[ctx->num_points - 1].size) {
+            format_size(levels[i].first_size, capacity, sizeof(capacity));
+            strncat(capacity, "+", sizeof(capacity) - strlen(capacity) - 1);
+        } else {
+            format_size(levels[i].capacity, capacity, sizeof(capacity));
+        }
+
+        cachebench_printf(ctx, "%s\t%s\t\t%.3f\t\t\t%.2f\t\t\t", levels[i].name, capacity,
+                          levels[i].latency_ns, levels[i].bandwidth);
+        if (i == 0) cachebench_printf(ctx, "-\n");
+        else cachebench_printf(ctx, "%.2fx\n", levels[i].latency_ns / levels[i - 1].latency_ns);
+    }
+    cachebench_printf(ctx, "\n");
+
+    size_t nominal[] = {L1_CACHE_SIZE, L2_CACHE_SIZE, L3_CACHE_SIZE};
+    for (int i = 0; i < num_levels && i < 3; i++) {
+        if (strcmp(levels[i].name, "DRAM") == 0) break;
+        if (i == num_levels - 1) break;
+
+        char detected[32], expected[32];
+        format_size(levels[i].capacity, detected, sizeof(detected));
+        format_size(nominal[i], expected, sizeof(expected));
+
+        if (levels[i].capacity * 2 <= nominal[i]) {
+            cachebench_printf(ctx, "⚠ %s Effective Capacity Below Nominal:\n", levels[i].name);
+            cachebench_printf(ctx, "  - Expected: %s, observed: latency step after %s\n", expected, detected);
+            cachebench_printf(ctx, "  - Possible causes:\n");
+            cachebench_printf(ctx, "    * Cache partitioning between cores or CCXs\n");
+            cachebench_printf(ctx, "    * OS/system overhead using cache space\n");
+            cachebench_printf(ctx, "    * Cache replacement policy effects\n");
+            cachebench_printf(ctx, "    * Effective working set limitations\n\n");
+        } else if (levels[i].capacity >= nominal[i] * 2) {
+            cachebench_printf(ctx, "⚠ %s Boundary Above Nominal:\n", levels[i].name);
+            cachebench_printf(ctx, "  - Expected: %s, observed: latency step after %s\n", expected, detected);
+            cachebench_printf(ctx, "  - Steps too small to resolve, or this host's caches differ from nominal\n\n");
+        } else {
+            cachebench_printf(ctx, "✓ %s Cache Performance (up to %s):\n", levels[i].name, detected);
+            cachebench_printf(ctx, "  - Random: %.3f ns/access, Sequential: %.2f GB/s\n",
+                              levels[i].latency_ns, levels[i].bandwidth);
+            cachebench_printf(ctx, "  - Consistent with nominal %s %s\n\n", expected, levels[i].name);
+        }
+    }
+
+    if (ctx->line_stride_efficiency > 0) {
+        cachebench_printf(ctx, "✓ Cache Line Confirmation:\n");
+        cachebench_printf(ctx, "  - %d-byte stride shows %.0f%% efficiency vs byte stride\n\n",
+                          CACHE_LINE_SIZE, ctx->line_stride_efficiency);
+    }
+
+    double min_ratio = DBL_MAX, max_ratio = 0;
+    for (int i = 0; i < ctx->num_points; i++) {
+        double ratio = ctx->curve[i].rand_ms / ctx->curve[i].seq_ms;
+        if (ratio < min_ratio) min_ratio = ratio;
+        if (ratio > max_ratio) max_ratio = ratio;
+    }
+
+    cachebench_printf(ctx, "💡 Optimization Insights:\n");
+    if (num_levels > 1) {
+        const cache_level_t* last_cache = &levels[num_levels - 2];
+        char hot[32];
+        format_size(last_cache->capacity, hot, sizeof(hot));
+        cachebench_printf(ctx, "  - Keep hot data under %s for best %s performance\n", hot, last_cache->name);
+        cachebench_printf(ctx, "  - Exceeding %s costs %.1fx per random access\n",
+                          hot, levels[num_levels - 1].latency_ns / last_cache->latency_ns);
+    } else {
+        cachebench_printf(ctx, "  - No capacity cliff detected within the tested range\n");
+    }
+    cachebench_printf(ctx, "  - Use %d-byte aligned data structures\n", CACHE_LINE_SIZE);
+    cachebench_printf(ctx, "  - Sequential access %.1f-%.1fx faster than random\n", min_ratio, max_ratio);
+    if (num_levels > 2) {
+        char critical[32];
+        format_size(levels[1].capacity, critical, sizeof(critical));
+        cachebench_printf(ctx, "  - Cache-conscious algorithms critical above %s\n", critical);
+    }
+    cachebench_printf(ctx, "================================\n");
+}
+
+static int compare_ranked(const void* a, const void* b) {
+    const double* x = a;
+    const double* y = b;
+    return (x[0] > y[0]) - (x[0] < y[0]);
+}
+
+// Two-sided Mann-Whitney U test, normal approximation with tie correction.
+// Returns the p-value, or 1 when either side has fewer than two samples.
+double mann_whitney_p(const double* a, int n1, const double* b, int n2) {
+    if (n1 < 2 || n2 < 2) return 1.0;
+    
+    // Pairs of (value, group) sorted by value
+    int n = n1 + n2;
+    double pooled[2 * 2 * RESULT_SAMPLES];
+    for (int i = 0; i < n1; i++) { pooled[2 * i] = a[i]; pooled[2 * i + 1] = 0; }
+    for (int i = 0; i < n2; i++) { pooled[2 * (n1 + i)] = b[i]; pooled[2 * (n1 + i) + 1] = 1; }
+    qsort(pooled, n, 2 * sizeof(double), compare_ranked);
+    
+    double rank_sum_a = 0, tie_term = 0;
+    for (int i = 0; i < n;) {
+        int j = i;
+        while (j + 1 < n && pooled[2 * (j + 1)] == pooled[2 * i]) j++;
+        double rank = (i + j) / 2.0 + 1;
+        int ties = j - i + 1;
+        tie_term += (double)ties * ties * ties - ties;
+        for (int k = i; k <= j; k++) {
+            if (pooled[2 * k + 1] == 0) rank_sum_a += rank;
+        }
+        i = j + 1;
+    }
+    
+    double u = rank_sum_a - n1 * (n1 + 1) / 2.0;
+    double mean = n1 * n2 / 2.0;
+    double var = n1 * n2 / 12.0 * ((n + 1) - tie_term / ((double)n * (n - 1)));
+    if (var <= 0) return 1.0;
+    
+    double z = (fabs(u - mean) - 0.5) / sqrt(var);
+    if (z < 0) z = 0;
+    return erfc(z / sqrt(2.0));
+}
+
+// Median of n <= RESULT_SAMPLES samples, leaving them in order
+double median_of_samples(const double* samples, int n) {
+    double sorted[RESULT_SAMPLES];
+    memcpy(sorted, samples, n * sizeof(double));
+    return median_of(sorted, n);
+}
+
+static const result_row_t* find_row(const result_set_t* set, const result_row_t* key) {
+    for (int i = 0; i < set->num_rows; i++) {
+        const result_row_t* row = &set->rows[i];
+        if (strcmp(row->test, key->test) == 0 && strcmp(row->params, key->params) == 0 &&
+            strcmp(row->metric, key->metric) == 0) {
+            return row;
+        }
+    }
+    return NULL;
+}
+
+static void print_host_field(FILE* out, const char* name, const char* base, const char* cand) {
+    fprintf(out, "  %-10s %s%s%s\n", name, base, strcmp(base, cand) ? "  ->  " : "",
+            strcmp(base, cand) ? cand : "");
+}
+
+// Align the rows of two stored runs by test, parameters and metric, and flag
+// changes in the median that are both significant (Mann-Whitney p < alpha)
+// and larger than the threshold. All stored metrics are lower-is-better.
+// Returns the number of regressions.
+int compare_results(const result_set_t* base, const result_set_t* cand,
+                    double threshold_pct, double alpha, FILE* out) {
+    fprintf(out, "=== Run Comparison ===\n");
+    fprintf(out, "Baseline:  %s (%s)\n", base->timestamp, base->host.fingerprint);
+    fprintf(out, "Candidate: %s (%s)\n", cand->timestamp, cand->host.fingerprint);
+    if (strcmp(base->host.fingerprint, cand->host.fingerprint) != 0) {
+        fprintf(out, "⚠ Host fingerprints differ; changes may reflect the host, not the software:\n");
+    }
+    print_host_field(out, "cpu", base->host.cpu, cand->host.cpu);
+    print_host_field(out, "microcode", base->host.microcode, cand->host.microcode);
+    print_host_field(out, "kernel", base->host.kernel, cand->host.kernel);
+    fprintf(out, "Threshold: %.1f%%, alpha: %g\n\n", threshold_pct, alpha);
+    
+    fprintf(out, "%-10s %-36s %-9s %12s %12s %9s %9s  %s\n",
+            "Test", "Parameters", "Metric", "Baseline", "Candidate", "Change", "p-value", "Verdict");
+    fprintf(out, "------------------------------------------------------------------------------------------------------------------\n");
+    
+    int regressions = 0, improvements = 0, unmatched = 0;
+    for (int i = 0; i < base->num_rows; i++) {
+        const result_row_t* b = &base->rows[i];
+        const result_row_t* c = find_row(cand, b);
+        if (!c) {
+            unmatched++;
+            continue;
+        }
+        
+        double base_median = median_of_samples(b->samples, b->num_samples);
+        double cand_median = median_of_samples(c->samples, c->num_samples);
+        double change = base_median > 0 ? (cand_median / base_median - 1.0) * 100.0 : 0;
+        double p = mann_whitney_p(b->samples, b->num_samples, c->samples, c->num_samples);
+        
+        const char* verdict = "";
+        if (p < alpha && fabs(change) >= threshold_pct) {
+            if (change > 0) {
+                verdict = "REGRESSION";
+                regressions++;
+            } else {
+                verdict = "improved";
+                improvements++;
+            }
+        }
+        
+        fprintf(out, "%-10s %-36s %-9s %12.4g %12.4g %+8.1f%% %9.4f  %s\n",
+                b->test, b->params, b->metric, base_median, cand_median, change, p, verdict);
+    }
+    
+    for (int i = 0; i < cand->num_rows; i++) {
+        if (!find_row(base, &cand->rows[i])) unmatched++;
+    }
+    
+    fprintf(out, "\n%d regression%s, %d improvement%s, %d row%s without a counterpart\n",
+            regressions, regressions == 1 ? "" : "s", improvements, improvements == 1 ? "" : "s",
+            unmatched, unmatched == 1 ? "" : "s");
+    return regressions;
+}
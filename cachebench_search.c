@@ -0,0 +1,239 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+#define SEARCH_LOOKUPS (32 * 1024)     // Lookups per sample
+#define SEARCH_NODE_KEYS 16            // B-tree keys per node: one 64-byte line
+#define SEARCH_NOT_FOUND INT32_MAX
+
+typedef enum {
+    SEARCH_BINARY,                     // lower_bound over a sorted array
+    SEARCH_BRANCHLESS,                 // Same array, conditional moves instead of branches
+    SEARCH_EYTZINGER,                  // BFS order, descendants four levels down prefetched
+    SEARCH_BTREE,                      // Line-sized nodes, keys compared with SIMD
+    NUM_SEARCH_LAYOUTS
+} search_layout_t;
+
+static const char* search_names[NUM_SEARCH_LAYOUTS] = {"binary", "branchless", "eytzinger", "btree"};
+
+static volatile int64_t search_sink;
+
+// Keys are the odd numbers 1, 3, 5, ... so lookups of even values miss
+static inline int32_t key_at(size_t i) {
+    return (int32_t)(2 * i + 1);
+}
+
+static int32_t lower_bound_binary(const int32_t* a, size_t n, int32_t x) {
+    size_t lo = 0;
+    while (n > 0) {
+        size_t half = n / 2;
+        if (a[lo + half] < x) {
+            lo += half + 1;
+            n -= half + 1;
+        } else {
+            n = half;
+        }
+    }
+    return a[lo];
+}
+
+static int32_t lower_bound_branchless(const int32_t* a, size_t n, int32_t x) {
+    const int32_t* base = a;
+    while (n > 1) {
+        size_t half = n / 2;
+        base = base[half] < x ? base + half : base;
+        n -= half;
+    }
+    return base[*base < x];
+}
+
+// b[1..n] in BFS order; b is line-aligned so b[16k..16k+15] share a line
+static int32_t lower_bound_eytzinger(const int32_t* b, size_t n, int32_t x) {
+    size_t k = 1;
+    while (k <= n) {
+        _mm_prefetch((const char*)(b + k * 16), _MM_HINT_T0);
+        k = 2 * k + (b[k] < x);
+    }
+    // Undo the right turns taken after the last left turn
+    k >>= __builtin_ffsll(~k);
+    return b[k];
+}
+
+// Keys in the node below x, i.e. the child to descend into
+static inline int node_rank(const int32_t* node, int32_t x) {
+#ifdef __AVX2__
+    __m256i target = _mm256_set1_epi32(x);
+    __m256i lo = _mm256_cmpgt_epi32(target, _mm256_load_si256((const __m256i*)node));
+    __m256i hi = _mm256_cmpgt_epi32(target, _mm256_load_si256((const __m256i*)(node + 8)));
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(lo)) |
+               _mm256_movemask_ps(_mm256_castsi256_ps(hi)) << 8;
+#else
+    __m128i target = _mm_set1_epi32(x);
+    int mask = 0;
+    for (int q = 0; q < 4; q++) {
+        __m128i keys = _mm_load_si128((const __m128i*)(node + 4 * q));
+        mask |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(target, keys))) << (4 * q);
+    }
+#endif
+    return __builtin_popcount(mask);
+}
+
+// Implicit static B-tree: node k has children k * 17 + 1 .. k * 17 + 17
+static int32_t lower_bound_btree(const int32_t* tree, size_t nodes, int32_t x) {
+    int32_t result = SEARCH_NOT_FOUND;
+    size_t k = 0;
+    while (k < nodes) {
+        const int32_t* node = tree + k * SEARCH_NODE_KEYS;
+        int i = node_rank(node, x);
+        if (i < SEARCH_NODE_KEYS) result = node[i];
+        k = k * (SEARCH_NODE_KEYS + 1) + i + 1;
+    }
+    return result;
+}
+
+// Fill the Eytzinger array by an in-order walk; returns the next key index
+static size_t build_eytzinger(int32_t* b, size_t n, size_t k, size_t i) {
+    if (k <= n) {
+        i = build_eytzinger(b, n, 2 * k, i);
+        b[k] = key_at(i++);
+        i = build_eytzinger(b, n, 2 * k + 1, i);
+    }
+    return i;
+}
+
+// Same for the B-tree; slots past the last key hold SEARCH_NOT_FOUND
+static size_t build_btree(int32_t* tree, size_t nodes, size_t n, size_t k, size_t i) {
+    if (k >= nodes) return i;
+    for (int j = 0; j <= SEARCH_NODE_KEYS; j++) {
+        i = build_btree(tree, nodes, n, k * (SEARCH_NODE_KEYS + 1) + j + 1, i);
+        if (j < SEARCH_NODE_KEYS) {
+            tree[k * SEARCH_NODE_KEYS + j] = i < n ? key_at(i) : SEARCH_NOT_FOUND;
+            i++;
+        }
+    }
+    return i;
+}
+
+// Lay out n keys for layout at the start of buffer; returns bytes used
+static size_t build_layout(search_layout_t layout, int32_t* buffer, size_t n) {
+    if (layout == SEARCH_EYTZINGER) {
+        buffer[0] = SEARCH_NOT_FOUND;  // Where a search past the last key ends
+        build_eytzinger(buffer, n, 1, 0);
+        return (n + 1) * sizeof(int32_t);
+    }
+    if (layout == SEARCH_BTREE) {
+        size_t nodes = (n + SEARCH_NODE_KEYS - 1) / SEARCH_NODE_KEYS;
+        build_btree(buffer, nodes, n, 0, 0);
+        return nodes * SEARCH_NODE_KEYS * sizeof(int32_t);
+    }
+    for (size_t i = 0; i < n; i++) buffer[i] = key_at(i);
+    buffer[n] = SEARCH_NOT_FOUND;      // lower_bound past the last key
+    return (n + 1) * sizeof(int32_t);
+}
+
+static int64_t search_all(search_layout_t layout, const int32_t* data, size_t n,
+                          const int32_t* queries, int count) {
+    int64_t sum = 0;
+    size_t nodes = (n + SEARCH_NODE_KEYS - 1) / SEARCH_NODE_KEYS;
+
+    switch (layout) {
+    case SEARCH_BINARY:
+        for (int i = 0; i < count; i++) sum += lower_bound_binary(data, n, queries[i]);
+        break;
+    case SEARCH_BRANCHLESS:
+        for (int i = 0; i < count; i++) sum += lower_bound_branchless(data, n, queries[i]);
+        break;
+    case SEARCH_EYTZINGER:
+        for (int i = 0; i < count; i++) sum += lower_bound_eytzinger(data, n, queries[i]);
+        break;
+    default:
+        for (int i = 0; i < count; i++) sum += lower_bound_btree(data, nodes, queries[i]);
+        break;
+    }
+    return sum;
+}
+
+static double time_search(cachebench_context_t* ctx, search_layout_t layout, int32_t* data,
+                          size_t bytes, size_t n, const int32_t* queries, int64_t* checksum,
+                          double* samples) {
+    double total = 0;
+    for (int s = 0; s < RESULT_SAMPLES; s++) {
+        precondition_buffer(ctx, (char*)data, bytes, ctx->mode);
+        double start_time = get_time_ms();
+        *checksum = search_all(layout, data, n, queries, SEARCH_LOOKUPS);
+        double ms = get_time_ms() - start_time;
+        samples[s] = ms * 1e6 / SEARCH_LOOKUPS;
+        total += samples[s];
+    }
+    search_sink = *checksum;
+    return total / RESULT_SAMPLES;
+}
+
+static void run_search_test(cachebench_context_t* ctx) {
+    sweep_config_t sweep = {MIN_SIZE, MAX_SIZE, 2, 0};
+    size_t sizes[MAX_SWEEP_POINTS];
+    int num_sizes = generate_sweep(&sweep, sizes, MAX_SWEEP_POINTS);
+
+    int32_t* buffer = (int32_t*)arena_buffer(ctx, sizes[num_sizes - 1]);
+    int32_t* queries = malloc(SEARCH_LOOKUPS * sizeof(int32_t));
+    if (!buffer || !queries) {
+        cachebench_printf(ctx, "Failed to allocate memory for search test\n");
+        free(queries);
+        return;
+    }
+
+    cachebench_printf(ctx, "=== Sorted Search Layouts ===\n");
+    cachebench_printf(ctx, "4-byte keys, %d random lower_bound lookups per sample (half miss); "
+                      "B-tree nodes of %d keys; %s preconditioning\n",
+                      SEARCH_LOOKUPS, SEARCH_NODE_KEYS, precondition_names[ctx->mode]);
+    cachebench_printf(ctx, "ns/lookup\n");
+    cachebench_printf(ctx, "Size\t\tKeys\t\tBinary\tBranchless\tEytzinger\tB-tree\tBest\n");
+    cachebench_printf(ctx, "----------------------------------------------------------------------------------\n");
+
+    for (int s = 0; s < num_sizes; s++) {
+        // One line is left for the Eytzinger root offset and end sentinel
+        size_t n = sizes[s] / sizeof(int32_t) - SEARCH_NODE_KEYS;
+        n -= n % SEARCH_NODE_KEYS;
+
+        // Uniform over [0, 2n], so about half land between keys
+        for (int i = 0; i < SEARCH_LOOKUPS; i++) {
+            queries[i] = (int32_t)((((size_t)rand() << 16) ^ (size_t)rand()) % (2 * n + 1));
+        }
+
+        double ns[NUM_SEARCH_LAYOUTS];
+        int64_t checksums[NUM_SEARCH_LAYOUTS];
+        int best = 0;
+        for (int l = 0; l < NUM_SEARCH_LAYOUTS; l++) {
+            double samples[RESULT_SAMPLES];
+            size_t bytes = build_layout(l, buffer, n);
+            ns[l] = time_search(ctx, l, buffer, bytes, n, queries, &checksums[l], samples);
+            if (ns[l] < ns[best]) best = l;
+
+            if (checksums[l] != checksums[0]) {
+                cachebench_printf(ctx, "⚠ %s search disagrees with binary search\n", search_names[l]);
+            }
+
+            char params[64];
+            snprintf(params, sizeof(params), "size=%zu,layout=%s,mode=%s",
+                     sizes[s], search_names[l], precondition_names[ctx->mode]);
+            record_result(&ctx->results, "search", params, "ns", samples, RESULT_SAMPLES);
+        }
+
+        char size_label[32];
+        format_size(sizes[s], size_label, sizeof(size_label));
+        cachebench_printf(ctx, "%-9s\t%-9zu\t%.1f\t%.1f\t\t%.1f\t\t%.1f\t%s\n",
+                          size_label, n, ns[SEARCH_BINARY], ns[SEARCH_BRANCHLESS],
+                          ns[SEARCH_EYTZINGER], ns[SEARCH_BTREE], search_names[best]);
+    }
+
+    free(queries);
+    cachebench_printf(ctx, "\n");
+}
+
+const cachebench_test_t search_test = {
+    "search", "lower_bound cost of binary, branchless, Eytzinger and B-tree layouts",
+    "size=4K..MAX_SIZE,layout=binary|branchless|eytzinger|btree", "ns",
+    0, run_search_test
+};
@@ -0,0 +1,186 @@
+#define _GNU_SOURCE
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sched.h>
+#include <immintrin.h>
+
+#ifdef __linux__
+#include <pthread.h>
+#endif
+
+const char* placement_names[NUM_PLACEMENTS] = {"any", "smt", "same-llc", "cross-llc", "cross-socket"};
+
+static int read_sysfs_int(const char* format, int cpu, int fallback) {
+    char path[128];
+    snprintf(path, sizeof(path), format, cpu);
+    FILE* f = fopen(path, "r");
+    if (!f) return fallback;
+    int value;
+    if (fscanf(f, "%d", &value) != 1) value = fallback;
+    fclose(f);
+    return value;
+}
+
+// The LLC is the highest cache index; its shared_cpu_list starts with the
+// lowest CPU of the domain
+static int llc_domain(int cpu, int fallback) {
+    int domain = fallback;
+    for (int index = 0; index < 8; index++) {
+        char path[128];
+        int id;
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list",
+                 cpu, index);
+        FILE* f = fopen(path, "r");
+        if (!f) break;
+        if (fscanf(f, "%d", &id) == 1) domain = id;
+        fclose(f);
+    }
+    return domain;
+}
+
+// Online CPUs with their core, LLC domain and package. Returns the CPU
+// count; without sysfs every CPU is its own core on one package.
+int get_cpu_topology(cpu_topology_t* topo) {
+    memset(topo, 0, sizeof(*topo));
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    if (online < 1) online = 1;
+
+    for (int cpu = 0; cpu < MAX_CPUS; cpu++) {
+        // Absent and offline CPUs have no topology directory
+        int package = read_sysfs_int("/sys/devices/system/cpu/cpu%d/topology/physical_package_id",
+                                     cpu, -1);
+        if (package < 0) continue;
+        cpu_info_t* info = &topo->cpus[topo->num_cpus++];
+        info->cpu = cpu;
+        info->package = package;
+        info->core = package * 4096 + read_sysfs_int("/sys/devices/system/cpu/cpu%d/topology/core_id",
+                                                     cpu, cpu);
+        info->llc = llc_domain(cpu, package);
+    }
+
+    if (topo->num_cpus == 0) {
+        for (int cpu = 0; cpu < online && cpu < MAX_CPUS; cpu++) {
+            topo->cpus[cpu] = (cpu_info_t){cpu, cpu, 0, 0};
+        }
+        topo->num_cpus = online < MAX_CPUS ? (int)online : MAX_CPUS;
+    }
+    return topo->num_cpus;
+}
+
+static int core_taken(const cpu_topology_t* topo, const int* cpus, int count, int core) {
+    for (int i = 0; i < count; i++) {
+        for (int c = 0; c < topo->num_cpus; c++) {
+            if (topo->cpus[c].cpu == cpus[i] && topo->cpus[c].core == core) return 1;
+        }
+    }
+    return 0;
+}
+
+// First CPU of a core not yet used whose domain key matches
+static int free_core(const cpu_topology_t* topo, const int* cpus, int placed,
+                     int by_package, int domain, int package) {
+    for (int c = 0; c < topo->num_cpus; c++) {
+        const cpu_info_t* info = &topo->cpus[c];
+        int key = by_package ? info->package : info->llc;
+        if (key != domain || info->package != package) continue;
+        if (!core_taken(topo, cpus, placed, info->core)) return info->cpu;
+    }
+    return -1;
+}
+
+// Round-robin threads over the LLC domains of one package, or over packages,
+// one core each
+static int spread_threads(const cpu_topology_t* topo, int by_package, int count, int* cpus) {
+    for (int anchor = 0; anchor < topo->num_cpus; anchor++) {
+        int package = topo->cpus[anchor].package;
+        int domains[MAX_CPUS], num_domains = 0;
+        for (int c = 0; c < topo->num_cpus; c++) {
+            const cpu_info_t* info = &topo->cpus[c];
+            if (!by_package && info->package != package) continue;
+            int key = by_package ? info->package : info->llc;
+            int seen = 0;
+            for (int d = 0; d < num_domains; d++) seen |= domains[d] == key;
+            if (!seen) domains[num_domains++] = key;
+        }
+        if (num_domains < 2) {
+            if (by_package) return -1;
+            continue;
+        }
+
+        int placed = 0;
+        for (; placed < count; placed++) {
+            int domain = domains[placed % num_domains];
+            cpus[placed] = free_core(topo, cpus, placed, by_package, domain,
+                                     by_package ? domain : package);
+            if (cpus[placed] < 0) break;
+        }
+        if (placed == count) return 0;
+        if (by_package) return -1;
+    }
+    return -1;
+}
+
+// Choose CPUs for count threads under placement. Returns -1 when this machine
+// has no such placement for that many threads; PLACEMENT_ANY leaves them
+// unpinned (cpu -1).
+int place_threads(const cpu_topology_t* topo, placement_t placement, int count, int* cpus) {
+    if (count < 1 || (count > topo->num_cpus && placement != PLACEMENT_ANY)) return -1;
+
+    switch (placement) {
+    case PLACEMENT_ANY:
+        for (int i = 0; i < count; i++) cpus[i] = -1;
+        return 0;
+    case PLACEMENT_SMT:
+        // Every thread on the same core
+        for (int c = 0; c < topo->num_cpus; c++) {
+            int placed = 0;
+            for (int s = 0; s < topo->num_cpus && placed < count; s++) {
+                if (topo->cpus[s].core == topo->cpus[c].core) cpus[placed++] = topo->cpus[s].cpu;
+            }
+            if (placed == count) return 0;
+        }
+        return -1;
+    case PLACEMENT_SAME_LLC:
+        // One core each, all under one LLC
+        for (int c = 0; c < topo->num_cpus; c++) {
+            int placed = 0;
+            while (placed < count) {
+                int cpu = free_core(topo, cpus, placed, 0, topo->cpus[c].llc, topo->cpus[c].package);
+                if (cpu < 0) break;
+                cpus[placed++] = cpu;
+            }
+            if (placed == count) return 0;
+        }
+        return -1;
+    case PLACEMENT_CROSS_LLC:
+        return spread_threads(topo, 0, count, cpus);
+    case PLACEMENT_CROSS_SOCKET:
+        return spread_threads(topo, 1, count, cpus);
+    default:
+        return -1;
+    }
+}
+
+// Pin the calling thread to cpu; -1 leaves it unpinned
+int pin_thread(int cpu) {
+    if (cpu < 0) return 0;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0 ? 0 : -1;
+#else
+    return -1;
+#endif
+}
+
+// One iteration of a busy-wait loop. Oversubscribed runs would otherwise
+// spin out whole time slices, so every SPIN_YIELD spins give up the CPU.
+void spin_wait(int* spins) {
+    _mm_pause();
+    if (++*spins % SPIN_YIELD == 0) sched_yield();
+}
@@ -0,0 +1,246 @@
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+
+#define TRAVERSAL_MIN_NODES (1024 * 1024) // Nodes visited per sample at least
+#define TRAVERSAL_MAX_DEPTH 64
+
+// One list or tree node; lists use only left
+typedef struct traversal_node {
+    struct traversal_node* left;
+    struct traversal_node* right;
+    uint64_t value;
+    uint64_t pad;                      // Round to 32 bytes, a typical small object
+} traversal_node_t;
+
+typedef enum {
+    ALLOC_MALLOC,                      // One malloc per node, in insertion order
+    ALLOC_POOL,                        // Consecutive slots of one pool, in insertion order
+    ALLOC_SHUFFLED,                    // Pool slots in random order
+    NUM_ALLOCS
+} node_alloc_t;
+
+typedef enum {
+    STRUCT_LIST,                       // Singly linked, walked in insertion order
+    STRUCT_TREE,                       // Complete binary tree inserted level by level, walked depth-first
+    NUM_STRUCTS
+} node_struct_t;
+
+static const char* alloc_names[NUM_ALLOCS] = {"malloc", "pool", "shuffled"};
+static const char* struct_names[NUM_STRUCTS] = {"list", "tree"};
+
+static volatile uint64_t traversal_sink;
+
+static uint64_t walk_list(const traversal_node_t* head) {
+    uint64_t sum = 0;
+    for (const traversal_node_t* n = head; n; n = n->left) sum += n->value;
+    return sum;
+}
+
+// Pre-order with an explicit stack, as an iterator over a tree would
+static uint64_t walk_tree(const traversal_node_t* root) {
+    const traversal_node_t* stack[TRAVERSAL_MAX_DEPTH];
+    int top = 0;
+    uint64_t sum = 0;
+
+    const traversal_node_t* n = root;
+    while (n || top > 0) {
+        if (!n) n = stack[--top];
+        sum += n->value;
+        if (n->right) stack[top++] = n->right;
+        n = n->left;
+    }
+    return sum;
+}
+
+static uint64_t walk_vector(const uint64_t* values, size_t count) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < count; i++) sum += values[i];
+    return sum;
+}
+
+static uint64_t walk(node_struct_t kind, const traversal_node_t* root) {
+    return kind == STRUCT_LIST ? walk_list(root) : walk_tree(root);
+}
+
+// Place count nodes; slots[i] is the node inserted i-th
+static int place_nodes(node_alloc_t alloc, traversal_node_t** slots, size_t count,
+                       traversal_node_t* pool) {
+    if (alloc == ALLOC_MALLOC) {
+        for (size_t i = 0; i < count; i++) {
+            slots[i] = malloc(sizeof(traversal_node_t));
+            if (!slots[i]) {
+                while (i > 0) free(slots[--i]);
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    for (size_t i = 0; i < count; i++) slots[i] = pool + i;
+    if (alloc == ALLOC_SHUFFLED) {
+        for (size_t i = count - 1; i > 0; i--) {
+            size_t j = (((size_t)rand() << 16) ^ (size_t)rand()) % (i + 1);
+            traversal_node_t* tmp = slots[i];
+            slots[i] = slots[j];
+            slots[j] = tmp;
+        }
+    }
+    return 0;
+}
+
+// Link the placed nodes into a list or a level-order complete tree
+static traversal_node_t* link_nodes(node_struct_t kind, traversal_node_t** slots, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        traversal_node_t* n = slots[i];
+        n->value = i;
+        n->pad = 0;
+        if (kind == STRUCT_LIST) {
+            n->left = i + 1 < count ? slots[i + 1] : NULL;
+            n->right = NULL;
+        } else {
+            n->left = 2 * i + 1 < count ? slots[2 * i + 1] : NULL;
+            n->right = 2 * i + 2 < count ? slots[2 * i + 2] : NULL;
+        }
+    }
+    return slots[0];
+}
+
+// precondition_buffer for nodes that need not be contiguous: warm reads and
+// dirty writes each node, cold flushes it
+static void precondition_nodes(cachebench_context_t* ctx, traversal_node_t** slots, size_t count) {
+    switch (ctx->mode) {
+    case PRECONDITION_WARM:
+        for (size_t i = 0; i < count; i++) traversal_sink += slots[i]->value;
+        break;
+    case PRECONDITION_DIRTY:
+        for (size_t i = 0; i < count; i++) slots[i]->pad = i;
+        break;
+    case PRECONDITION_COLD:
+        for (size_t i = 0; i < count; i++) _mm_clflush(slots[i]);
+        _mm_mfence();
+        break;
+    default:
+        precondition_buffer(ctx, NULL, 0, ctx->mode);
+        break;
+    }
+}
+
+static double time_walk(cachebench_context_t* ctx, node_struct_t kind, traversal_node_t** slots,
+                        size_t count, double* samples) {
+    int passes = (int)(TRAVERSAL_MIN_NODES / count);
+    if (passes < 1) passes = 1;
+
+    uint64_t expected = (uint64_t)count * (count - 1) / 2;
+    double total = 0;
+    for (int s = 0; s < RESULT_SAMPLES; s++) {
+        precondition_nodes(ctx, slots, count);
+        uint64_t sum = 0;
+        double start_time = get_time_ms();
+        for (int p = 0; p < passes; p++) sum += walk(kind, slots[0]);
+        double ms = get_time_ms() - start_time;
+
+        if (sum != expected * passes) {
+            cachebench_printf(ctx, "⚠ %s walk visited the wrong nodes\n", struct_names[kind]);
+        }
+        traversal_sink = sum;
+        samples[s] = ms * 1e6 / ((double)count * passes);
+        total += samples[s];
+    }
+    return total / RESULT_SAMPLES;
+}
+
+static double time_vector(cachebench_context_t* ctx, uint64_t* values, size_t count, double* samples) {
+    int passes = (int)(TRAVERSAL_MIN_NODES / count);
+    if (passes < 1) passes = 1;
+
+    double total = 0;
+    for (int s = 0; s < RESULT_SAMPLES; s++) {
+        precondition_buffer(ctx, values, count * sizeof(uint64_t), ctx->mode);
+        uint64_t sum = 0;
+        double start_time = get_time_ms();
+        for (int p = 0; p < passes; p++) sum += walk_vector(values, count);
+        double ms = get_time_ms() - start_time;
+        traversal_sink = sum;
+        samples[s] = ms * 1e6 / ((double)count * passes);
+        total += samples[s];
+    }
+    return total / RESULT_SAMPLES;
+}
+
+static void run_traversal_test(cachebench_context_t* ctx) {
+    sweep_config_t sweep = {MIN_SIZE, MAX_SIZE / 2, 1, 0};
+    size_t sizes[MAX_SWEEP_POINTS];
+    int num_sizes = generate_sweep(&sweep, sizes, MAX_SWEEP_POINTS);
+
+    // Node pool first, the flat vector after it
+    size_t max_nodes = sizes[num_sizes - 1] / sizeof(traversal_node_t);
+    char* buffer = arena_buffer(ctx, sizes[num_sizes - 1] + max_nodes * sizeof(uint64_t));
+    traversal_node_t** slots = malloc(max_nodes * sizeof(traversal_node_t*));
+    if (!buffer || !slots) {
+        cachebench_printf(ctx, "Failed to allocate memory for traversal test\n");
+        free(slots);
+        return;
+    }
+    traversal_node_t* pool = (traversal_node_t*)buffer;
+    uint64_t* values = (uint64_t*)(buffer + sizes[num_sizes - 1]);
+
+    cachebench_printf(ctx, "=== Linked Structure Traversal ===\n");
+    cachebench_printf(ctx, "%zu-byte nodes placed by malloc, a pool in insertion order, or a "
+                      "shuffled pool; %s preconditioning\n",
+                      sizeof(traversal_node_t), precondition_names[ctx->mode]);
+    cachebench_printf(ctx, "ns/node\n");
+    cachebench_printf(ctx, "Size\t\tNodes\t\tList: malloc\tpool\tshuffled\tTree: malloc\tpool\tshuffled\tVector\n");
+    cachebench_printf(ctx, "------------------------------------------------------------------------------------------------------------\n");
+
+    for (int s = 0; s < num_sizes; s++) {
+        size_t count = sizes[s] / sizeof(traversal_node_t);
+        double ns[NUM_STRUCTS][NUM_ALLOCS];
+        double samples[RESULT_SAMPLES];
+        char params[64];
+
+        for (int k = 0; k < NUM_STRUCTS; k++) {
+            for (int a = 0; a < NUM_ALLOCS; a++) {
+                if (place_nodes(a, slots, count, pool) != 0) {
+                    cachebench_printf(ctx, "Failed to allocate %zu nodes\n", count);
+                    free(slots);
+                    return;
+                }
+                link_nodes(k, slots, count);
+                ns[k][a] = time_walk(ctx, k, slots, count, samples);
+                if (a == ALLOC_MALLOC) {
+                    for (size_t i = 0; i < count; i++) free(slots[i]);
+                }
+
+                snprintf(params, sizeof(params), "struct=%s,alloc=%s,size=%zu,mode=%s",
+                         struct_names[k], alloc_names[a], sizes[s], precondition_names[ctx->mode]);
+                record_result(&ctx->results, "traversal", params, "ns", samples, RESULT_SAMPLES);
+            }
+        }
+
+        for (size_t i = 0; i < count; i++) values[i] = i;
+        double vector_ns = time_vector(ctx, values, count, samples);
+        snprintf(params, sizeof(params), "struct=vector,size=%zu,mode=%s",
+                 sizes[s], precondition_names[ctx->mode]);
+        record_result(&ctx->results, "traversal", params, "ns", samples, RESULT_SAMPLES);
+
+        char size_label[32];
+        format_size(sizes[s], size_label, sizeof(size_label));
+        cachebench_printf(ctx, "%-9s\t%-9zu\t%.2f\t\t%.2f\t%.2f\t\t%.2f\t\t%.2f\t%.2f\t\t%.2f\n",
+                          size_label, count,
+                          ns[STRUCT_LIST][ALLOC_MALLOC], ns[STRUCT_LIST][ALLOC_POOL],
+                          ns[STRUCT_LIST][ALLOC_SHUFFLED], ns[STRUCT_TREE][ALLOC_MALLOC],
+                          ns[STRUCT_TREE][ALLOC_POOL], ns[STRUCT_TREE][ALLOC_SHUFFLED], vector_ns);
+    }
+
+    free(slots);
+    cachebench_printf(ctx, "\n");
+}
+
+const cachebench_test_t traversal_test = {
+    "traversal", "Walk lists and trees placed by malloc, a pool, or a shuffled pool, vs a vector",
+    "struct=list|tree|vector,alloc=malloc|pool|shuffled,size=4K..MAX_SIZE/2", "ns",
+    0, run_traversal_test
+};
@@ -0,0 +1,351 @@
+#define _GNU_SOURCE
+#include "cachebench.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#ifdef HAVE_IO_URING
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+#endif
+
+#define URING_MAX_QD 128
+#define URING_MAX_BLOCK (1024 * 1024)
+#define URING_POOL (4 * 1024 * 1024)   // Read buffers, registered as one; slots share them past this
+#define URING_SAMPLE_OPS 2048          // Reads per timed sample, fewer for large blocks
+#define URING_SAMPLE_BYTES (32 * 1024 * 1024)
+#define URING_SQPOLL_IDLE_MS 1000
+#define URING_IOV_BYTES 4096           // preadv: one iovec per page
+
+#ifdef HAVE_IO_URING
+
+// A ring set up with raw syscalls: the SQ and CQ rings and the SQE array
+// mapped from the ring descriptor, as liburing does
+typedef struct {
+    int fd;
+    int sqpoll;
+    unsigned* sq_tail;
+    unsigned* sq_mask;
+    unsigned* sq_flags;
+    unsigned* sq_array;
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned* cq_mask;
+    struct io_uring_sqe* sqes;
+    struct io_uring_cqe* cqes;
+    void* sq_ring;
+    size_t sq_ring_len;
+    void* cq_ring;
+    size_t cq_ring_len;
+    size_t sqes_len;
+} uring_t;
+
+static void uring_free(uring_t* ring) {
+    if (ring->sqes) munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_ring && ring->cq_ring != ring->sq_ring) munmap(ring->cq_ring, ring->cq_ring_len);
+    if (ring->sq_ring) munmap(ring->sq_ring, ring->sq_ring_len);
+    if (ring->fd >= 0) close(ring->fd);
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+static void* map_ring(int fd, size_t len, off_t offset) {
+    void* p = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+// Returns 0, or -1 when io_uring (or SQPOLL) is unavailable
+static int uring_init(uring_t* ring, unsigned entries, int sqpoll) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(ring, 0, sizeof(*ring));
+    if (sqpoll) {
+        p.flags = IORING_SETUP_SQPOLL;
+        p.sq_thread_idle = URING_SQPOLL_IDLE_MS;
+    }
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd < 0) return -1;
+    ring->sqpoll = sqpoll;
+
+    ring->sq_ring_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_ring_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    int single = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single && ring->cq_ring_len > ring->sq_ring_len) ring->sq_ring_len = ring->cq_ring_len;
+
+    ring->sq_ring = map_ring(ring->fd, ring->sq_ring_len, IORING_OFF_SQ_RING);
+    ring->cq_ring = single ? ring->sq_ring : map_ring(ring->fd, ring->cq_ring_len, IORING_OFF_CQ_RING);
+    ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = map_ring(ring->fd, ring->sqes_len, IORING_OFF_SQES);
+    if (!ring->sq_ring || !ring->cq_ring || !ring->sqes) {
+        uring_free(ring);
+        return -1;
+    }
+
+    char* sq = ring->sq_ring;
+    char* cq = ring->cq_ring;
+    ring->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned*)(sq + p.sq_off.ring_mask);
+    ring->sq_flags = (unsigned*)(sq + p.sq_off.flags);
+    ring->sq_array = (unsigned*)(sq + p.sq_off.array);
+    ring->cq_head = (unsigned*)(cq + p.cq_off.head);
+    ring->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned*)(cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    return 0;
+}
+
+// Queue one read; fixed reads use registered file 0 and buffer 0
+static void uring_prep_read(uring_t* ring, int fixed, int fd, char* buf, unsigned len,
+                            uint64_t offset, uint64_t user_data) {
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->flags = fixed ? IOSQE_FIXED_FILE : 0;
+    sqe->fd = fixed ? 0 : fd;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->off = offset;
+    sqe->user_data = user_data;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+// Submit queued reads and wait for at least wait completions. An SQPOLL
+// ring's kernel thread submits on its own; it only needs a wakeup when idle.
+static int uring_enter(uring_t* ring, unsigned submit, unsigned wait) {
+    unsigned flags = wait ? IORING_ENTER_GETEVENTS : 0;
+    if (ring->sqpoll) {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(ring->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP) {
+            flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+        submit = 0;
+        if (!flags) return 0;
+    }
+    int ret;
+    do {
+        ret = (int)syscall(__NR_io_uring_enter, ring->fd, submit, wait, flags, NULL, 0);
+    } while (ret < 0 && errno == EINTR);
+    return ret;
+}
+
+typedef enum {
+    READ_PREAD,
+    READ_PREADV,
+    READ_URING,
+    READ_URING_FIXED,                  // Registered buffers and file
+    READ_URING_SQPOLL,                 // SQPOLL, registered buffers and file
+    NUM_READ_METHODS
+} read_method_t;
+
+static const char* read_method_names[NUM_READ_METHODS] = {
+    "pread", "preadv", "uring", "uring-fixed", "uring-sqpoll"
+};
+
+static char* slot_buffer(char* pool, int slot, size_t block) {
+    return pool + ((size_t)slot * block) % URING_POOL;
+}
+
+// One synchronous read per call; returns -1 on a short read
+static int sync_read(read_method_t method, int fd, char* buf, size_t block, uint64_t offset) {
+    if (method == READ_PREAD) {
+        return pread(fd, buf, block, (off_t)offset) == (ssize_t)block ? 0 : -1;
+    }
+    struct iovec iov[URING_MAX_BLOCK / URING_IOV_BYTES];
+    int count = (int)(block / URING_IOV_BYTES);
+    for (int i = 0; i < count; i++) {
+        iov[i].iov_base = buf + (size_t)i * URING_IOV_BYTES;
+        iov[i].iov_len = URING_IOV_BYTES;
+    }
+    return preadv(fd, iov, count, (off_t)offset) == (ssize_t)block ? 0 : -1;
+}
+
+// ops reads of block bytes at the block indices in order, qd in flight.
+// Records per-read latency in TSC cycles; returns elapsed ns or -1.
+static double run_reads(read_method_t method, uring_t* ring, int fd, char* pool, size_t block,
+                        int qd, const size_t* order, size_t ops, latency_histogram_t* hist) {
+    double start = get_time_ms();
+
+    if (method == READ_PREAD || method == READ_PREADV) {
+        for (size_t i = 0; i < ops; i++) {
+            uint64_t t0 = get_cycles();
+            if (sync_read(method, fd, pool, block, order[i] * block) != 0) return -1;
+            histogram_record(hist, get_cycles() - t0);
+        }
+        return (get_time_ms() - start) * 1e6;
+    }
+
+    int fixed = method != READ_URING;
+    uint64_t submitted_at[URING_MAX_QD];
+    size_t issued = 0, done = 0;
+    unsigned to_submit = 0;
+
+    for (int slot = 0; slot < qd && issued < ops; slot++, issued++, to_submit++) {
+        submitted_at[slot] = get_cycles();
+        uring_prep_read(ring, fixed, fd, slot_buffer(pool, slot, block), (unsigned)block,
+                        order[issued] * block, (uint64_t)slot);
+    }
+
+    while (done < ops) {
+        if (uring_enter(ring, to_submit, 1) < 0) return -1;
+        to_submit = 0;
+
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        uint64_t now = get_cycles();
+        for (; head != tail; head++) {
+            struct io_uring_cqe* cqe = &ring->cqes[head & *ring->cq_mask];
+            if (cqe->res != (int)block) return -1;
+            int slot = (int)cqe->user_data;
+            histogram_record(hist, now - submitted_at[slot]);
+            done++;
+
+            if (issued < ops) {
+                submitted_at[slot] = get_cycles();
+                uring_prep_read(ring, fixed, fd, slot_buffer(pool, slot, block), (unsigned)block,
+                                order[issued] * block, (uint64_t)slot);
+                issued++;
+                to_submit++;
+            }
+        }
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+    }
+    return (get_time_ms() - start) * 1e6;
+}
+
+// Register the buffer pool and file with ring for fixed reads
+static int register_fixed(uring_t* ring, int fd, char* pool) {
+    struct iovec iov = {pool, URING_POOL};
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_BUFFERS, &iov, 1) != 0) return -1;
+    if (syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_FILES, &fd, 1) != 0) return -1;
+    return 0;
+}
+
+#endif
+
+static void run_uring_test(cachebench_context_t* ctx) {
+#ifndef HAVE_IO_URING
+    cachebench_printf(ctx, "io_uring test needs Linux io_uring headers; not supported on this build\n\n");
+#else
+    char path[512];
+    int fd = create_bench_file(ctx, path, sizeof(path));
+    if (fd < 0) {
+        cachebench_printf(ctx, "Failed to create a %zu byte file under %s\n", ctx->file.size,
+                          ctx->file.dir ? ctx->file.dir : "$TMPDIR or /var/tmp");
+        return;
+    }
+    size_t size = ctx->file.size & ~(size_t)(URING_MAX_BLOCK - 1);
+    char* pool = aligned_alloc(4096, URING_POOL);
+    size_t* order = malloc(URING_SAMPLE_OPS * sizeof(size_t));
+    latency_histogram_t* hist = malloc(sizeof(latency_histogram_t));
+    uring_t rings[NUM_READ_METHODS];
+    const char* unavailable[NUM_READ_METHODS] = {NULL};
+    for (int m = 0; m < NUM_READ_METHODS; m++) rings[m].fd = -1;
+    if (!pool || !order || !hist) {
+        cachebench_printf(ctx, "Failed to allocate memory for io_uring test\n");
+        goto done;
+    }
+    memset(pool, 0, URING_POOL);
+
+    // Page-cache hot: read the whole file once
+    for (size_t offset = 0; offset < size; offset += URING_MAX_BLOCK) {
+        if (pread(fd, pool, URING_MAX_BLOCK, (off_t)offset) != URING_MAX_BLOCK) break;
+    }
+
+    for (int m = READ_URING; m < NUM_READ_METHODS; m++) {
+        if (uring_init(&rings[m], URING_MAX_QD, m == READ_URING_SQPOLL) != 0) {
+            unavailable[m] = m == READ_URING_SQPOLL ? "SQPOLL setup failed" : "io_uring_setup failed";
+        } else if (m != READ_URING && register_fixed(&rings[m], fd, pool) != 0) {
+            unavailable[m] = "buffer registration failed (RLIMIT_MEMLOCK?)";
+        }
+    }
+    double tsc_ghz = measure_tsc_ghz();
+
+    char label[32];
+    format_size(size, label, sizeof(label));
+    cachebench_printf(ctx, "=== io_uring vs pread ===\n");
+    cachebench_printf(ctx, "Random reads from a page-cache-hot %s file at %s; latency from "
+                      "submission to completion\n", label, path);
+    for (int m = READ_URING; m < NUM_READ_METHODS; m++) {
+        if (unavailable[m]) cachebench_printf(ctx, "%s: %s\n", read_method_names[m], unavailable[m]);
+    }
+    cachebench_printf(ctx, "\n");
+
+    for (size_t block = 4096; block <= URING_MAX_BLOCK; block *= 4) {
+        size_t ops = URING_SAMPLE_BYTES / block;
+        if (ops > URING_SAMPLE_OPS) ops = URING_SAMPLE_OPS;
+        size_t blocks = size / block;
+
+        char block_label[32];
+        format_size(block, block_label, sizeof(block_label));
+        cachebench_printf(ctx, "%s reads\n", block_label);
+        cachebench_printf(ctx, "Method\t\tQD\tKIOPS\tGB/s\tp50 us\tp99 us\tp99.9 us\n");
+        cachebench_printf(ctx, "----------------------------------------------------------------\n");
+
+        for (int m = 0; m < NUM_READ_METHODS; m++) {
+            if (unavailable[m]) continue;
+            // The synchronous calls have one read in flight
+            int max_qd = m == READ_PREAD || m == READ_PREADV ? 1 : URING_MAX_QD;
+
+            for (int qd = 1; qd <= max_qd; qd *= 2) {
+                double samples[RESULT_SAMPLES];
+                int failed = 0;
+                memset(hist, 0, sizeof(*hist));
+                for (int s = 0; s < RESULT_SAMPLES && !failed; s++) {
+                    for (size_t i = 0; i < ops; i++) {
+                        order[i] = (((size_t)rand() << 31) ^ (size_t)rand()) % blocks;
+                    }
+                    double ns = run_reads(m, &rings[m], fd, pool, block, qd, order, ops, hist);
+                    failed = ns < 0;
+                    samples[s] = ns / ops;
+                }
+                if (failed) {
+                    cachebench_printf(ctx, "%-12s\t%d\tread failed\n", read_method_names[m], qd);
+                    break;
+                }
+
+                double ns = median_of_samples(samples, RESULT_SAMPLES);
+                cachebench_printf(ctx, "%-12s\t%d\t%.1f\t%.2f\t%.1f\t%.1f\t%.1f\n",
+                                  read_method_names[m], qd, 1e6 / ns, block / ns,
+                                  histogram_percentile(hist, 50) / tsc_ghz / 1000,
+                                  histogram_percentile(hist, 99) / tsc_ghz / 1000,
+                                  histogram_percentile(hist, 99.9) / tsc_ghz / 1000);
+
+                char params[64];
+                snprintf(params, sizeof(params), "method=%s,qd=%d,block=%zu",
+                         read_method_names[m], qd, block);
+                record_result(&ctx->results, "uring", params, "ns", samples, RESULT_SAMPLES);
+            }
+        }
+        cachebench_printf(ctx, "\n");
+    }
+
+done:
+    for (int m = READ_URING; m < NUM_READ_METHODS; m++) {
+        if (rings[m].fd >= 0) uring_free(&rings[m]);
+    }
+    free(hist);
+    free(order);
+    free(pool);
+    close(fd);
+    unlink(path);
+#endif
+}
+
+const cachebench_test_t uring_test = {
+    "uring", "Page-cache-hot random reads: pread, preadv, io_uring (fixed, SQPOLL) at QD 1-128",
+    "method=pread|preadv|uring|uring-fixed|uring-sqpoll,qd=1..128,block=4K..1M", "ns",
+    0, run_uring_test
+};
@@ -0,0 +1,226 @@
+#include "cachebench.h"
+
+#include <string.h>
+#include <immintrin.h>
+
+#define WIDTH_SAMPLE_BYTES (4 * 1024 * 1024) // Bytes loaded per timed sample
+#define WIDTH_DRAM_FACTOR 4            // DRAM buffer: this many times the last cache level
+#define NUM_WIDTHS 7
+
+static const int widths[NUM_WIDTHS] = {1, 2, 4, 8, 16, 32, 64};
+
+// 256- and 512-bit integer adds need AVX2 and AVX-512
+#ifdef __AVX2__
+#define HAVE_WIDTH_32 1
+#else
+#define HAVE_WIDTH_32 0
+#endif
+#ifdef __AVX512F__
+#define HAVE_WIDTH_64 1
+#else
+#define HAVE_WIDTH_64 0
+#endif
+
+static const int width_available[NUM_WIDTHS] = {1, 1, 1, 1, 1, HAVE_WIDTH_32, HAVE_WIDTH_64};
+
+// Misalignment of the first element from a cache line boundary; elements
+// follow back to back, so an offset that is not a multiple of the width
+// splits some of them across lines
+static const int offsets[] = {0, 1, 2, 4, 8, 16, 32};
+#define NUM_OFFSETS ((int)(sizeof(offsets) / sizeof(offsets[0])))
+
+// Without it the compiler merges narrow loads into vector loads
+#define compiler_barrier() __asm__ __volatile__("" ::: "memory")
+
+static volatile uint64_t width_sink;
+
+typedef uint64_t (*stream_loop_t)(const char* p, size_t n);
+
+// n back-to-back scalar loads of width T, four per iteration into separate
+// sums so the adds do not bound throughput; n is a multiple of 4
+#define DEFINE_SCALAR_LOOP(W, T) \
+    static uint64_t stream_loop_##W(const char* p, size_t n) { \
+        uint64_t a = 0, b = 0, c = 0, d = 0; \
+        for (size_t i = 0; i < n; i += 4, p += 4 * W) { \
+            T v0, v1, v2, v3; \
+            memcpy(&v0, p, W); \
+            memcpy(&v1, p + W, W); \
+            memcpy(&v2, p + 2 * W, W); \
+            memcpy(&v3, p + 3 * W, W); \
+            a += v0; b += v1; c += v2; d += v3; \
+            compiler_barrier(); \
+        } \
+        return a + b + c + d; \
+    }
+
+DEFINE_SCALAR_LOOP(1, uint8_t)
+DEFINE_SCALAR_LOOP(2, uint16_t)
+DEFINE_SCALAR_LOOP(4, uint32_t)
+DEFINE_SCALAR_LOOP(8, uint64_t)
+
+// The same with unaligned vector loads of type V
+#define DEFINE_VECTOR_LOOP(W, V, LOAD, ADD, LOW) \
+    static uint64_t stream_loop_##W(const char* p, size_t n) { \
+        V a, b, c, d; \
+        memset(&a, 0, sizeof(a)); \
+        b = c = d = a; \
+        for (size_t i = 0; i < n; i += 4, p += 4 * W) { \
+            a = ADD(a, LOAD((const V*)p)); \
+            b = ADD(b, LOAD((const V*)(p + W))); \
+            c = ADD(c, LOAD((const V*)(p + 2 * W))); \
+            d = ADD(d, LOAD((const V*)(p + 3 * W))); \
+            compiler_barrier(); \
+        } \
+        return (uint64_t)LOW(ADD(ADD(a, b), ADD(c, d))); \
+    }
+
+DEFINE_VECTOR_LOOP(16, __m128i, _mm_loadu_si128, _mm_add_epi64, _mm_cvtsi128_si64)
+
+#if HAVE_WIDTH_32
+#define LOW_256(v) _mm_cvtsi128_si64(_mm256_castsi256_si128(v))
+DEFINE_VECTOR_LOOP(32, __m256i, _mm256_loadu_si256, _mm256_add_epi64, LOW_256)
+#else
+// Never timed; defined so the kernel table compiles
+static uint64_t stream_loop_32(const char* p, size_t n) { return stream_loop_16(p, n); }
+#endif
+
+#if HAVE_WIDTH_64
+#define LOW_512(v) _mm_cvtsi128_si64(_mm512_castsi512_si128(v))
+#define LOAD_512(p) _mm512_loadu_si512((const void*)(p))
+DEFINE_VECTOR_LOOP(64, __m512i, LOAD_512, _mm512_add_epi64, LOW_512)
+#else
+static uint64_t stream_loop_64(const char* p, size_t n) { return stream_loop_16(p, n); }
+#endif
+
+static const stream_loop_t stream_loops[NUM_WIDTHS] = {
+    stream_loop_1, stream_loop_2, stream_loop_4, stream_loop_8,
+    stream_loop_16, stream_loop_32, stream_loop_64
+};
+
+// Loads of widths[w] starting offset bytes into buffer, in windows of
+// WIDTH_SAMPLE_BYTES: whole passes for buffers smaller than that, otherwise
+// successive windows so a DRAM-sized buffer never hits in the caches.
+// Returns TSC cycles per load, median of RESULT_SAMPLES after one warm-up.
+static double time_stream(char* buffer, size_t size, int w, int offset, double* samples) {
+    int width = widths[w];
+    // One line of slack keeps the misaligned tail inside the buffer
+    size_t window = size < WIDTH_SAMPLE_BYTES ? size : WIDTH_SAMPLE_BYTES;
+    size_t loads = (window - CACHE_LINE_SIZE) / width & ~(size_t)3;
+    int passes = (int)(WIDTH_SAMPLE_BYTES / window);
+    size_t cursor = 0;
+
+    for (int s = -1; s < RESULT_SAMPLES; s++) {
+        uint64_t sum = 0;
+        uint64_t start = get_cycles();
+        for (int pass = 0; pass < passes; pass++) {
+            sum += stream_loops[w](buffer + cursor + offset, loads);
+        }
+        uint64_t cycles = get_cycles() - start;
+        width_sink = sum;
+
+        cursor += window;
+        if (cursor + window > size) cursor = 0;
+        if (s >= 0) samples[s] = (double)cycles / ((double)loads * passes);
+    }
+    return median_of_samples(samples, RESULT_SAMPLES);
+}
+
+static void run_width_test(cachebench_context_t* ctx) {
+    level_limit_t limits[MAX_LEVELS];
+    const char* source;
+    int num_limits = get_cache_limits(ctx, limits, &source);
+
+    // Half of each level, so the buffer stays resident next to other data,
+    // then a multiple of the last level when MAX_SIZE allows one
+    size_t sizes[MAX_LEVELS + 1];
+    char names[MAX_LEVELS + 1][8];
+    int num_sizes = 0;
+    for (int l = 0; l <= num_limits; l++) {
+        size_t size;
+        if (l < num_limits) {
+            size = limits[l].capacity / 2;
+            memcpy(names[num_sizes], limits[l].name, sizeof(names[num_sizes]));
+        } else {
+            size = limits[num_limits - 1].capacity * WIDTH_DRAM_FACTOR;
+            if (size > MAX_SIZE) size = MAX_SIZE;
+            if (size <= limits[num_limits - 1].capacity) break;
+            strcpy(names[num_sizes], "DRAM");
+        }
+        size &= ~(size_t)(CACHE_LINE_SIZE - 1);
+        if (size <= CACHE_LINE_SIZE || (num_sizes > 0 && size <= sizes[num_sizes - 1])) continue;
+        sizes[num_sizes++] = size;
+    }
+
+    char* buffer = arena_buffer(ctx, sizes[num_sizes - 1]);
+    if (!buffer) {
+        cachebench_printf(ctx, "Failed to allocate memory for width test\n");
+        return;
+    }
+    double tsc_ghz = measure_tsc_ghz();
+
+    cachebench_printf(ctx, "=== Access Width and Alignment ===\n");
+    cachebench_printf(ctx, "Back-to-back loads from a line offset, %s cache sizes, %s preconditioning, "
+                      "TSC %.3f GHz\n", source, precondition_names[ctx->mode], tsc_ghz);
+    if (num_sizes <= num_limits) {
+        cachebench_printf(ctx, "DRAM skipped: MAX_SIZE fits in %s\n", limits[num_limits - 1].name);
+    }
+    cachebench_printf(ctx, "\n");
+
+    for (int i = 0; i < num_sizes; i++) {
+        size_t size = sizes[i];
+        char label[32];
+        format_size(size, label, sizeof(label));
+        precondition_buffer(ctx, buffer, size, ctx->mode);
+
+        cachebench_printf(ctx, "%s-resident (%s), GB/s by offset\n", names[i], label);
+        cachebench_printf(ctx, "Width");
+        for (int o = 0; o < NUM_OFFSETS; o++) cachebench_printf(ctx, "\t%d", offsets[o]);
+        cachebench_printf(ctx, "\tLoads/cycle (aligned, worst)\n");
+        cachebench_printf(ctx, "------------------------------------------------------------------------------------\n");
+
+        double worst_ratio = 1.0;
+        int worst_width = 0, worst_offset = 0;
+        for (int w = 0; w < NUM_WIDTHS; w++) {
+            if (!width_available[w]) {
+                cachebench_printf(ctx, "%d B\tn/a (needs %s)\n", widths[w],
+                                  widths[w] == 32 ? "AVX2" : "AVX-512");
+                continue;
+            }
+
+            double cycles[NUM_OFFSETS];
+            int worst = 0;
+            cachebench_printf(ctx, "%d B", widths[w]);
+            for (int o = 0; o < NUM_OFFSETS; o++) {
+                double samples[RESULT_SAMPLES];
+                cycles[o] = time_stream(buffer, size, w, offsets[o], samples);
+                if (cycles[o] > cycles[worst]) worst = o;
+
+                char params[64];
+                snprintf(params, sizeof(params), "level=%s,size=%zu,width=%d,offset=%d",
+                         names[i], size, widths[w], offsets[o]);
+                record_result(&ctx->results, "width", params, "cycles", samples, RESULT_SAMPLES);
+
+                cachebench_printf(ctx, "\t%.1f", widths[w] * tsc_ghz / cycles[o]);
+            }
+            cachebench_printf(ctx, "\t%.2f, %.2f\n", 1.0 / cycles[0], 1.0 / cycles[worst]);
+
+            if (cycles[worst] / cycles[0] > worst_ratio) {
+                worst_ratio = cycles[worst] / cycles[0];
+                worst_width = widths[w];
+                worst_offset = offsets[worst];
+            }
+        }
+        if (worst_width > 0) {
+            cachebench_printf(ctx, "Worst misalignment: %.2fx slower (%d B loads at offset %d)\n\n",
+                              worst_ratio, worst_width, worst_offset);
+        } else {
+            cachebench_printf(ctx, "Misalignment costs nothing measurable\n\n");
+        }
+    }
+}
+
+const cachebench_test_t width_test = {
+    "width", "Load bandwidth by access width (1-64 B) and misalignment per cache level",
+    "level=L1..DRAM,width=1..64,offset=0..32", "cycles",
+    0, run_width_test
+};